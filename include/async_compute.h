@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "queue_submission.h"
+#include "vulkan_context.h"
+
+namespace vulkanctx {
+
+// Records the compute work of a frame. slot is the frame in flight index, so
+// anything written per frame should be duplicated per slot.
+using ComputeRecorder = std::function<void(
+    const VkCommandBuffer &, const uint32_t &slot, const uint64_t &frame)>;
+
+// Runs compute work on the compute queue alongside the graphics queue, one
+// submission per frame. Ordering is done with two timeline semaphores
+// counting frames: the graphics submission of frame N waits for compute
+// frame N at the consumer stage, and compute frame N waits for the graphics
+// frame that last used the slot to be done with its resources. Shared
+// buffers are handed between the queue families around every frame if those
+// differ.
+//
+// Timestamps at both ends of either side measure how long compute and
+// graphics ran and how much of that overlapped. The begin timestamps are
+// written at the stages their submissions wait at, so neither counts the
+// time spent waiting for the other side or the swap chain. That relies on
+// both queues ticking the same device clock, which holds on desktop drivers.
+class AsyncCompute {
+  public:
+    // consumerStage and consumerAccess are how graphics uses what compute
+    // produced, e.g. the vertex shader reading a storage buffer
+    AsyncCompute(const VkDevice &device,
+                 const VkPhysicalDevice &physicalDevice,
+                 const VkSurfaceKHR &surface,
+                 const uint32_t &slotCount,
+                 const VkPipelineStageFlags &consumerStage,
+                 const VkAccessFlags &consumerAccess,
+                 ComputeRecorder recorder);
+
+    AsyncCompute(const AsyncCompute &) = delete;
+    auto operator=(const AsyncCompute &) -> AsyncCompute & = delete;
+
+    // Buffers with exclusive sharing that compute writes in the slot and
+    // graphics reads. Their ownership transfers are recorded automatically.
+    auto shareBuffer(const uint32_t &slot, const VkBuffer &buffer) -> void;
+
+    // Records and submits the compute work of a frame. The in flight fence of
+    // the slot has to be signaled, as drawFrame makes sure of.
+    auto submit(const uint32_t &slot, const uint64_t &frame) -> void;
+
+    // Go first and last in the graphics submission of the frame
+    auto graphicsBegin(const uint32_t &slot) const -> VkCommandBuffer;
+    auto graphicsEnd(const uint32_t &slot) const -> VkCommandBuffer;
+
+    // The graphics submission waits on the former with the frame number at
+    // consumerStage() and signals the latter with it
+    auto computeTimeline() const -> VkSemaphore;
+    auto graphicsTimeline() const -> VkSemaphore;
+    auto consumerStage() const -> VkPipelineStageFlags;
+
+    // Reads the timestamps of the last frame in the slot. The in flight fence
+    // of the slot has to be signaled.
+    auto collect(const uint32_t &slot) -> void;
+
+    auto report(std::ostream &stream) const -> void;
+
+  private:
+    struct Slot {
+        UniqueCommandBuffer compute;
+        UniqueCommandBuffer graphicsBegin;
+        UniqueCommandBuffer graphicsEnd;
+        std::vector<VkBuffer> buffers;
+
+        // Whether the last frame in the slot left the buffers with graphics
+        bool graphicsOwned = false;
+
+        // Frame whose timestamps are pending, 0 if none
+        uint64_t frame = 0;
+
+        // Last frame submitted in the slot. Slots needn't be used in turn,
+        // as the number of frames in flight may change.
+        uint64_t lastFrame = 0;
+    };
+
+    auto transfers(const Slot &slot,
+                   const uint32_t &srcFamily,
+                   const uint32_t &dstFamily,
+                   const VkAccessFlags &srcAccess,
+                   const VkAccessFlags &dstAccess) const
+        -> std::vector<VkBufferMemoryBarrier>;
+
+    auto recordCompute(Slot &slot, const uint32_t &index, const uint64_t &frame)
+        -> void;
+    auto recordGraphics(Slot &slot, const uint32_t &index) -> void;
+
+    VkDevice device_;
+    VkQueue computeQueue_;
+    uint32_t computeFamily_;
+    uint32_t graphicsFamily_;
+    VkPipelineStageFlags consumerStage_;
+    VkAccessFlags consumerAccess_;
+    ComputeRecorder recorder_;
+
+    UniqueCommandPool computePool_;
+    UniqueCommandPool graphicsPool_;
+    UniqueSemaphore computeTimeline_;
+    UniqueSemaphore graphicsTimeline_;
+    SubmissionBuilder computeSubmission_;
+
+    // Four per slot: compute begin and end, graphics begin and end
+    UniqueQueryPool queryPool_;
+    bool timestamps_ = false;
+    double timestampPeriod_ = 0.0;
+
+    std::vector<Slot> slots_;
+
+    uint64_t framesMeasured_ = 0;
+    double computeNanoseconds_ = 0.0;
+    double graphicsNanoseconds_ = 0.0;
+    double overlapNanoseconds_ = 0.0;
+};
+
+} // namespace vulkanctx
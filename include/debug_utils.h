@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+#include "diagnostics.h"
+#include "object_tracker.h"
+
+namespace vulkanctx {
+
+// Object names and command buffer labels go through VK_EXT_debug_utils, so
+// that validation messages and captures from tools like RenderDoc show them
+// instead of bare handles. Non-release builds enable the extension whenever
+// the loader offers it; without it both do nothing, and release builds
+// compile them out entirely.
+
+auto nameObject(const VkDevice &device,
+                const VkObjectType &type,
+                const uint64_t &handle,
+                const std::string &name) -> void;
+
+// After the type and where it was created, e.g. "fence (frame_depth.cpp:42)".
+// Every UniqueHandle is named this way when it takes over its handle.
+auto nameCreatedObject(const VkDevice &device,
+                       const VkObjectType &type,
+                       const uint64_t &handle,
+                       const char *file,
+                       const int &line) -> void;
+
+// Replaces the automatic name with one that says what the object is for,
+// numbered unless index is negative: "in flight fence 1"
+template <typename Handle>
+auto setObjectName(const VkDevice &device,
+                   const VkObjectType &type,
+                   const Handle &handle,
+                   const char *name,
+                   const int &index = -1) -> void {
+    if constexpr (diagnosticsCompiledIn) {
+        nameObject(device,
+                   type,
+                   objectHandle(handle),
+                   index < 0 ? std::string(name)
+                             : name + std::string(" ") + std::to_string(index));
+    }
+}
+
+// Groups the commands recorded while it is alive under a label, which may
+// nest. Labels only make sense within one command buffer.
+class DebugLabel {
+  public:
+    DebugLabel(const VkCommandBuffer &commandBuffer, const char *name)
+        : commandBuffer_(commandBuffer) {
+        if constexpr (diagnosticsCompiledIn) {
+            begin(name);
+        }
+    }
+
+    ~DebugLabel() {
+        if constexpr (diagnosticsCompiledIn) {
+            end();
+        }
+    }
+
+    DebugLabel(const DebugLabel &) = delete;
+    auto operator=(const DebugLabel &) -> DebugLabel & = delete;
+
+  private:
+    auto begin(const char *name) -> void;
+    auto end() -> void;
+
+    VkCommandBuffer commandBuffer_;
+    bool open_ = false;
+};
+
+} // namespace vulkanctx
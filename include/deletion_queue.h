@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "vulkan_handle.h"
+
+namespace vulkanctx {
+
+// Defers the destruction of objects that frames still in flight may be using.
+// Every entry is tagged with the number of the last frame that used it and
+// is destroyed by collect() once that frame has retired, which is tracked by
+// the in flight fences of the SynchronizationObject. Replacing resources thus
+// never has to stall on vkDeviceWaitIdle.
+class DeletionQueue {
+  public:
+    DeletionQueue() = default;
+
+    // Destroys whatever is left, so the device has to be idle by then
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue &) = delete;
+    auto operator=(const DeletionQueue &) -> DeletionQueue & = delete;
+
+    auto push(uint64_t lastUsedFrame, std::function<void()> deleter) -> void;
+
+    template <typename Traits>
+    auto retire(uint64_t lastUsedFrame, UniqueHandle<Traits> &&handle)
+        -> void {
+        if (!handle) {
+            return;
+        }
+
+        auto parent = handle.parent();
+        auto raw = handle.release();
+
+        push(lastUsedFrame,
+             [parent, raw] { destroyHandle<Traits>(parent, raw); });
+    }
+
+    template <typename Traits>
+    auto retire(uint64_t lastUsedFrame,
+                std::vector<UniqueHandle<Traits>> &&handles) -> void {
+        for (auto &handle : handles) {
+            retire(lastUsedFrame, std::move(handle));
+        }
+
+        handles.clear();
+    }
+
+    // Destroys every entry whose frame is at or before retiredFrame, in the
+    // order they were pushed. Returns how many were destroyed.
+    auto collect(uint64_t retiredFrame) -> size_t;
+
+    auto flush() -> void;
+
+    auto size() const -> size_t;
+
+  private:
+    struct Entry {
+        uint64_t frame;
+        std::function<void()> deleter;
+    };
+
+    std::vector<Entry> entries_;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>
+
+// Every device level command the project calls, maintained by hand and kept
+// in alphabetical order. A command used without being listed here goes to
+// the loader's export instead. Commands of extensions that weren't enabled
+// are loaded as null.
+#define VULKANCTX_DEVICE_COMMANDS(X)                                           \
+    X(vkAcquireNextImageKHR)                                                   \
+    X(vkAllocateCommandBuffers)                                                \
+    X(vkAllocateDescriptorSets)                                                \
+    X(vkAllocateMemory)                                                        \
+    X(vkBeginCommandBuffer)                                                    \
+    X(vkBindBufferMemory)                                                      \
+    X(vkBindImageMemory)                                                       \
+    X(vkCmdBeginDebugUtilsLabelEXT)                                            \
+    X(vkCmdBeginRenderPass)                                                    \
+    X(vkCmdBindDescriptorSets)                                                 \
+    X(vkCmdBindPipeline)                                                       \
+    X(vkCmdCopyImageToBuffer)                                                  \
+    X(vkCmdDispatch)                                                           \
+    X(vkCmdDispatchIndirect)                                                   \
+    X(vkCmdDraw)                                                               \
+    X(vkCmdEndDebugUtilsLabelEXT)                                              \
+    X(vkCmdEndRenderPass)                                                      \
+    X(vkCmdPipelineBarrier)                                                    \
+    X(vkCmdPipelineBarrier2)                                                   \
+    X(vkCmdPushConstants)                                                      \
+    X(vkCmdResetQueryPool)                                                     \
+    X(vkCmdWriteTimestamp)                                                     \
+    X(vkCreateBuffer)                                                          \
+    X(vkCreateCommandPool)                                                     \
+    X(vkCreateComputePipelines)                                                \
+    X(vkCreateDescriptorPool)                                                  \
+    X(vkCreateDescriptorSetLayout)                                             \
+    X(vkCreateFence)                                                           \
+    X(vkCreateFramebuffer)                                                     \
+    X(vkCreateGraphicsPipelines)                                               \
+    X(vkCreateImage)                                                           \
+    X(vkCreateImageView)                                                       \
+    X(vkCreatePipelineLayout)                                                  \
+    X(vkCreateQueryPool)                                                       \
+    X(vkCreateRenderPass)                                                      \
+    X(vkCreateSampler)                                                         \
+    X(vkCreateSemaphore)                                                       \
+    X(vkCreateShaderModule)                                                    \
+    X(vkCreateSwapchainKHR)                                                    \
+    X(vkDestroyBuffer)                                                         \
+    X(vkDestroyCommandPool)                                                    \
+    X(vkDestroyDescriptorPool)                                                 \
+    X(vkDestroyDescriptorSetLayout)                                            \
+    X(vkDestroyDevice)                                                         \
+    X(vkDestroyFence)                                                          \
+    X(vkDestroyFramebuffer)                                                    \
+    X(vkDestroyImage)                                                          \
+    X(vkDestroyImageView)                                                      \
+    X(vkDestroyPipeline)                                                       \
+    X(vkDestroyPipelineLayout)                                                 \
+    X(vkDestroyQueryPool)                                                      \
+    X(vkDestroyRenderPass)                                                     \
+    X(vkDestroySampler)                                                        \
+    X(vkDestroySemaphore)                                                      \
+    X(vkDestroyShaderModule)                                                   \
+    X(vkDestroySwapchainKHR)                                                   \
+    X(vkDeviceWaitIdle)                                                        \
+    X(vkEndCommandBuffer)                                                      \
+    X(vkFreeCommandBuffers)                                                    \
+    X(vkFreeMemory)                                                            \
+    X(vkGetBufferMemoryRequirements)                                           \
+    X(vkGetDeviceQueue)                                                        \
+    X(vkGetFenceStatus)                                                        \
+    X(vkGetImageMemoryRequirements)                                            \
+    X(vkGetImageSubresourceLayout)                                             \
+    X(vkGetMemoryFdKHR)                                                        \
+    X(vkGetQueryPoolResults)                                                   \
+    X(vkGetSemaphoreFdKHR)                                                     \
+    X(vkGetSwapchainImagesKHR)                                                 \
+    X(vkInvalidateMappedMemoryRanges)                                          \
+    X(vkMapMemory)                                                             \
+    X(vkQueuePresentKHR)                                                       \
+    X(vkQueueSubmit)                                                           \
+    X(vkQueueSubmit2)                                                          \
+    X(vkQueueWaitIdle)                                                         \
+    X(vkResetFences)                                                           \
+    X(vkSetDebugUtilsObjectNameEXT)                                            \
+    X(vkUpdateDescriptorSets)                                                  \
+    X(vkWaitForFences)                                                         \
+    X(vkWaitForPresentKHR)
+
+// Commands promoted to core that devices below that version may still offer
+// through the extension, under its name
+#define VULKANCTX_DEVICE_COMMAND_ALIASES(X)                                    \
+    X(vkCmdPipelineBarrier2, vkCmdPipelineBarrier2KHR)                         \
+    X(vkQueueSubmit2, vkQueueSubmit2KHR)
+
+namespace vulkanctx {
+
+// Device commands called through the loader's exports go through a
+// trampoline that looks up the device's dispatch table on every call. These
+// pointers come from vkGetDeviceProcAddr instead and go straight to the
+// driver, or to the first enabled layer.
+//
+// They are named like the loader's exports on purpose. Unqualified calls in
+// the definitions of vulkanctx functions find the pointers first, and since
+// those aren't functions, argument dependent lookup doesn't bring the
+// exports back in. Code outside the namespace, including file local helpers,
+// has to call vulkanctx::vkQueueSubmit and so on explicitly.
+#define VULKANCTX_DECLARE_COMMAND(name) extern PFN_##name name;
+VULKANCTX_DEVICE_COMMANDS(VULKANCTX_DECLARE_COMMAND)
+#undef VULKANCTX_DECLARE_COMMAND
+
+// Loads the pointers of the process' device right after it is created. There
+// is only ever one device per process: the windowed context's, or the
+// headless one of an export mode or benchmark.
+auto loadDeviceDispatch(const VkDevice &device) -> void;
+
+// Called once the device is destroyed so that stale pointers fail loudly
+auto unloadDeviceDispatch() -> void;
+
+// Measures the cost per call of a few device commands through the loader
+// and through the loaded pointers on a headless device
+auto runDispatchBenchmark(const char *applicationName,
+                          const uint64_t &callCount,
+                          std::ostream &stream) -> void;
+
+} // namespace vulkanctx
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace vulkanctx {
+
+// Optional device features the library makes use of when they are there
+struct DeviceFeatures {
+    // Highest version both the instance and the device support
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+
+    bool shaderDrawParameters = false;
+    bool timelineSemaphore = false;
+    bool bufferDeviceAddress = false;
+
+    // Runtime sized arrays of sampled images that are partially bound,
+    // updated after binding and indexed non-uniformly, as bindless
+    // texturing needs them
+    bool descriptorIndexing = false;
+
+    bool synchronization2 = false;
+    bool dynamicRendering = false;
+
+    // Ids for presents and waiting until they are on screen. Both need
+    // swap chains, devices without them shouldn't ask for these.
+    bool presentId = false;
+    bool presentWait = false;
+};
+
+// Every feature above, which is what devices are created with by default
+auto allDeviceFeatures() -> DeviceFeatures;
+
+// Highest version the loader supports, capped at the 1.3 the library is
+// written against. Instances are created with it.
+auto instanceApiVersion() -> uint32_t;
+
+// Builds the feature structures that enable the requested features on
+// device creation. A feature is enabled through the core structure of the
+// version it was promoted to if the device supports that version, or
+// through its extension otherwise. Those the device has neither for are
+// dropped, so the enabled set may be smaller than the requested one.
+class DeviceFeatureChain {
+  public:
+    DeviceFeatureChain(const VkPhysicalDevice &physicalDevice,
+                       const DeviceFeatures &requested);
+
+    // The structures point into each other
+    DeviceFeatureChain(const DeviceFeatureChain &) = delete;
+    auto operator=(const DeviceFeatureChain &) -> DeviceFeatureChain & = delete;
+
+    // Prepends the structures to the pNext chain of createInfo, in place of
+    // pEnabledFeatures, and appends the extensions they need. The chain has
+    // to outlive the vkCreateDevice call.
+    auto attach(VkDeviceCreateInfo &createInfo,
+                std::vector<const char *> &extensions) -> void;
+
+    auto enabled() const -> const DeviceFeatures &;
+
+  private:
+    auto link() -> void;
+
+    bool useFeatures2_ = false;
+    bool useVulkan12_ = false;
+    bool useVulkan13_ = false;
+    bool useTimelineExtension_ = false;
+    bool useSynchronization2Extension_ = false;
+    bool usePresentIdExtension_ = false;
+    bool usePresentWaitExtension_ = false;
+
+    DeviceFeatures enabled_;
+
+    VkPhysicalDeviceFeatures2 features_{};
+    VkPhysicalDeviceVulkan11Features vulkan11_{};
+    VkPhysicalDeviceVulkan12Features vulkan12_{};
+    VkPhysicalDeviceVulkan13Features vulkan13_{};
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore_{};
+    VkPhysicalDeviceSynchronization2Features synchronization2_{};
+    VkPhysicalDevicePresentIdFeaturesKHR presentId_{};
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWait_{};
+};
+
+// What the device supports out of DeviceFeatures
+auto queryDeviceFeatures(const VkPhysicalDevice &physicalDevice)
+    -> DeviceFeatures;
+
+// Features of the process' device, recorded when it is created. Code that
+// can make use of a feature checks here rather than asking the physical
+// device, which may support more than was enabled.
+auto enabledDeviceFeatures() -> const DeviceFeatures &;
+auto setEnabledDeviceFeatures(const DeviceFeatures &features) -> void;
+
+auto reportDeviceFeatures(std::ostream &stream) -> void;
+
+} // namespace vulkanctx
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+namespace vulkanctx {
+
+// Release builds (NODEBUG) compile every diagnostic out so that no layer is
+// loaded, no messenger is installed and none of the checks cost anything
+#ifdef NODEBUG
+constexpr bool diagnosticsCompiledIn = false;
+#else
+constexpr bool diagnosticsCompiledIn = true;
+#endif
+
+struct DiagnosticsConfig {
+    bool validation = false;
+    bool gpuAssisted = false;
+    bool bestPractices = false;
+    bool synchronization = false;
+
+    auto profileName() const -> std::string;
+};
+
+// Parses a comma separated list of toggles: validation, gpu-assisted,
+// best-practices and synchronization, or one of the profiles off and full.
+// Every toggle besides validation implies the validation layer.
+auto parseDiagnostics(const std::string &description) -> DiagnosticsConfig;
+
+// The active configuration, resolved once from the VULKANCTX_DIAGNOSTICS
+// environment variable, falling back to the build time DIAGNOSTICS setting
+auto diagnosticsConfig() -> const DiagnosticsConfig &;
+
+auto reportDiagnostics(std::ostream &stream) -> void;
+
+} // namespace vulkanctx
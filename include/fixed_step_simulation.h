@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+
+#include "triple_buffer.h"
+
+namespace vulkanctx {
+
+// Advances State in fixed steps on its own thread, decoupled from the
+// frame rate. After every batch of steps the thread publishes the last two
+// states through a triple buffer, together with when the newer one became
+// due. sample() blends between those two by how far the given time is into
+// the next step, so rendering always shows the state one step behind.
+//
+// Neither side waits for the other: the render thread only swaps buffer
+// indices, and the simulation never looks at what was rendered. Steps the
+// thread missed, e.g. while descheduled, are caught up to a bound, beyond
+// which simulation time falls behind instead of spiralling.
+template <typename State> class FixedStepSimulation {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // Advances a state by dt seconds
+    using Step = std::function<void(State &, const double &dt)>;
+
+    // Blends from one state to the next, alpha between 0 and 1
+    using Blend = std::function<State(
+        const State &, const State &, const double &alpha)>;
+
+    FixedStepSimulation(const State &initial,
+                        const double &stepsPerSecond,
+                        Step step,
+                        Blend blend)
+        : period_(std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(1.0 / stepsPerSecond))),
+          dt_(1.0 / stepsPerSecond), step_(std::move(step)),
+          blend_(std::move(blend)),
+          snapshots_(Snapshot{initial, initial, Clock::now()}) {
+        thread_ = std::thread([this, initial] { run(initial); });
+    }
+
+    ~FixedStepSimulation() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopRequested_ = true;
+        }
+
+        stopped_.notify_one();
+        thread_.join();
+    }
+
+    FixedStepSimulation(const FixedStepSimulation &) = delete;
+    auto operator=(const FixedStepSimulation &)
+        -> FixedStepSimulation & = delete;
+
+    // Consumer only, the state to show at time
+    auto sample(const Clock::time_point &time) -> State {
+        samples_++;
+        newSnapshots_ += snapshots_.update() ? 1 : 0;
+
+        const Snapshot &snapshot = snapshots_.front();
+        const double alpha =
+            std::chrono::duration<double>(time - snapshot.time).count() / dt_;
+
+        // Past the next step the simulation is late, and guessing ahead
+        // would only have to be taken back
+        if (alpha >= 1.0) {
+            stalledSamples_++;
+        }
+
+        return blend_(
+            snapshot.previous, snapshot.current, std::clamp(alpha, 0.0, 1.0));
+    }
+
+    // Consumer only
+    auto report(std::ostream &stream) const -> void {
+        const uint64_t steps = steps_.load(std::memory_order_relaxed);
+
+        stream << std::fixed << std::setprecision(1) << "Simulation at "
+               << 1.0 / dt_ << " Hz: " << steps << " steps ("
+               << lateSteps_.load(std::memory_order_relaxed)
+               << " caught up, "
+               << droppedSteps_.load(std::memory_order_relaxed)
+               << " dropped), " << samples_ << " samples (" << newSnapshots_
+               << " new, " << stalledSamples_ << " past the next step)"
+               << std::defaultfloat << std::endl;
+    }
+
+  private:
+    struct Snapshot {
+        State previous;
+        State current;
+
+        // When current became due
+        Clock::time_point time;
+    };
+
+    // Steps owed at once beyond which the rest are dropped
+    static constexpr uint32_t maxCatchUp = 8;
+
+    auto run(State current) -> void {
+        State previous = current;
+        Clock::time_point due = Clock::now();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (!stopRequested_) {
+            const Clock::time_point now = Clock::now();
+            uint32_t taken = 0;
+
+            while (due + period_ <= now && taken < maxCatchUp) {
+                previous = current;
+                step_(current, dt_);
+                due += period_;
+                taken++;
+            }
+
+            if (taken > 1) {
+                lateSteps_.fetch_add(taken - 1, std::memory_order_relaxed);
+            }
+
+            // Gives up on the backlog, simulation time lags from here on
+            if (due + period_ <= now) {
+                const auto behind = (now - due) / period_;
+
+                droppedSteps_.fetch_add(behind, std::memory_order_relaxed);
+                due += behind * period_;
+            }
+
+            if (taken > 0) {
+                steps_.fetch_add(taken, std::memory_order_relaxed);
+                snapshots_.back() = Snapshot{previous, current, due};
+                snapshots_.publish();
+            }
+
+            stopped_.wait_until(
+                lock, due + period_, [this] { return stopRequested_; });
+        }
+    }
+
+    const Clock::duration period_;
+    const double dt_;
+    Step step_;
+    Blend blend_;
+
+    TripleBuffer<Snapshot> snapshots_;
+
+    // Only for stopping, the render thread never touches it
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool stopRequested_ = false;
+
+    // Simulation side
+    std::atomic<uint64_t> steps_{0};
+    std::atomic<uint64_t> lateSteps_{0};
+    std::atomic<uint64_t> droppedSteps_{0};
+
+    // Consumer side
+    uint64_t samples_ = 0;
+    uint64_t newSnapshots_ = 0;
+    uint64_t stalledSamples_ = 0;
+
+    std::thread thread_;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "frame_pacing.h"
+#include "vulkan_handle.h"
+
+namespace vulkanctx {
+
+// Picks how many frames may be in flight from how long the CPU spent
+// preparing a frame and how long the GPU ran it, both averaged over a few
+// dozen frames:
+//
+// - If one side takes a small fraction of the other, running them one after
+//   the other barely costs throughput, so a single frame is in flight and
+//   input reaches the screen a frame sooner.
+// - If the CPU takes longer, every slot up to the maximum is used, so that
+//   slow frames on the CPU don't leave the GPU idle.
+// - Otherwise two frames overlap CPU and GPU work without queueing more.
+//
+// A latency sensitive workload always gets a single frame. A new depth is
+// only taken once it was picked several times in a row.
+//
+// The GPU time comes from timestamps around the frame's graphics submission.
+// The first one is only taken once the swap chain images were acquired, so
+// time spent waiting for the display doesn't count. Without timestamps only
+// the latency sensitive rule applies.
+class FrameDepthController {
+  public:
+    FrameDepthController(const VkDevice &device,
+                         const VkPhysicalDevice &physicalDevice,
+                         const VkSurfaceKHR &surface,
+                         const uint32_t &maxDepth);
+
+    FrameDepthController(const FrameDepthController &) = delete;
+    auto operator=(const FrameDepthController &)
+        -> FrameDepthController & = delete;
+
+    // Go first and last in the graphics submission of the frame, begin in
+    // the batch that waits for the acquires
+    auto begin(const uint32_t &slot) const -> VkCommandBuffer;
+    auto end(const uint32_t &slot) const -> VkCommandBuffer;
+
+    // The frame in the slot was submitted after cpuTime of work
+    auto submitted(const uint32_t &slot,
+                   const FramePacing::Clock::duration &cpuTime) -> void;
+
+    // Reads the GPU time of the last frame in the slot and reconsiders the
+    // depth. The in flight fence of the slot has to be signaled.
+    auto collect(const uint32_t &slot) -> void;
+
+    auto setLatencySensitive(const bool &latencySensitive) -> void;
+
+    auto depth() const -> uint32_t;
+    auto maxDepth() const -> uint32_t;
+
+    auto report(std::ostream &stream) const -> void;
+
+  private:
+    struct Slot {
+        UniqueCommandBuffer begin;
+        UniqueCommandBuffer end;
+        FramePacing::Clock::duration cpuTime{};
+        bool pending = false;
+    };
+
+    auto decide(const double &cpuNanoseconds, const double &gpuNanoseconds)
+        -> void;
+
+    VkDevice device_;
+    uint32_t maxDepth_;
+    uint32_t depth_;
+    bool latencySensitive_ = false;
+
+    UniqueCommandPool commandPool_;
+    UniqueQueryPool queryPool_;
+    bool timestamps_ = false;
+    float timestampPeriod_ = 1.0f;
+    std::vector<Slot> slots_;
+
+    // Of the frames measured since the last decision
+    uint32_t samples_ = 0;
+    double cpuNanoseconds_ = 0.0;
+    double gpuNanoseconds_ = 0.0;
+
+    uint32_t candidate_ = 0;
+    uint32_t candidateCount_ = 0;
+
+    // Over the whole run
+    uint64_t framesMeasured_ = 0;
+    double totalCpuNanoseconds_ = 0.0;
+    double totalGpuNanoseconds_ = 0.0;
+    uint64_t depthChanges_ = 0;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace vulkanctx {
+
+// Headless export of rendered frames to another process without copies. The
+// producer renders into a ring of linear images whose memory is exported
+// with VK_KHR_external_memory_fd and handed to the consumer once, over a
+// Unix socket. After that every frame is announced with its ring slot and,
+// where the driver can export one, a sync file descriptor that signals when
+// rendering is done. The consumer imports the same memory into its own
+// device, maps it, and gives the slot back when it is done reading.
+struct ExportOptions {
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t imageCount = 3;
+    uint64_t frameCount = 600;
+};
+
+struct ExportStatistics {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    bool syncFd = false;
+};
+
+// Creates a listening socket at path and returns the first connection
+auto acceptExportConsumer(const std::string &path) -> int;
+auto connectExportProducer(const std::string &path) -> int;
+
+// Both take ownership of the connected socket
+auto runExportProducer(const char *applicationName,
+                       int socket,
+                       const ExportOptions &options) -> ExportStatistics;
+auto runExportConsumer(const char *applicationName, int socket)
+    -> ExportStatistics;
+
+// Runs a producer and a stand-in consumer in a forked child, connected by a
+// socket pair, and reports the throughput both sides saw. Has to be called
+// before anything else touched Vulkan or GLFW in this process.
+auto runExportBenchmark(const char *applicationName,
+                        const ExportOptions &options,
+                        std::ostream &stream) -> void;
+
+auto reportExport(std::ostream &stream,
+                  const char *role,
+                  const ExportStatistics &statistics) -> void;
+
+} // namespace vulkanctx
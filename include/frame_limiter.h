@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace vulkanctx {
+
+// Caps the render loop at a target frame rate, so that present modes which
+// never block, like mailbox, don't render frames nobody will see.
+//
+// Frame starts are placed on a fixed grid of deadlines one period apart
+// rather than a period after the last frame, so that late frames don't push
+// every later one back. A frame that is more than a period late starts the
+// grid anew instead of rushing the missed frames. The wait sleeps until
+// shortly before the deadline and spins for the rest, as sleeps tend to
+// overshoot. How far ahead it wakes follows the worst overshoot seen
+// recently.
+class FrameLimiter {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameLimiter(const double &framesPerSecond);
+
+    // Blocks until the next frame is due and returns when it started
+    auto wait() -> Clock::time_point;
+
+    auto period() const -> Clock::duration;
+
+    // How far frame starts were off their deadlines and how even the
+    // intervals between them were
+    auto report(std::ostream &stream) const -> void;
+
+  private:
+    Clock::duration period_;
+    Clock::time_point deadline_{};
+    Clock::duration spinMargin_;
+
+    uint64_t frames_ = 0;
+    uint64_t resyncs_ = 0;
+    Clock::duration slept_{};
+    Clock::duration spun_{};
+
+    // Start minus deadline, summed over every frame
+    Clock::duration lateness_{};
+    Clock::duration maxLateness_{};
+
+    Clock::time_point lastStart_{};
+    uint64_t intervals_ = 0;
+    double intervalSum_ = 0.0;
+    double intervalSquares_ = 0.0;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace vulkanctx {
+
+// Frame statistics of one window. The time spent acquiring its next image is
+// how long the window's own display held the render loop back, and the time
+// between its presents shows how evenly it was fed. Latency runs from when
+// the frame's input was sampled until the frame was on screen, or until it
+// was handed to the presentation engine where that can't be observed.
+class FramePacing {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    auto acquired(const Clock::duration &wait) -> void;
+    auto presented(const Clock::time_point &time) -> void;
+
+    // A frame that was meant for the window but didn't reach it
+    auto dropped() -> void;
+
+    auto latency(const Clock::duration &inputToPresent, const bool &onScreen)
+        -> void;
+
+    auto report(std::ostream &stream, const std::string &name) const -> void;
+
+  private:
+    uint64_t framesPresented_ = 0;
+    uint64_t framesDropped_ = 0;
+
+    uint64_t acquires_ = 0;
+    Clock::duration acquireWait_{};
+    Clock::duration longestAcquireWait_{};
+
+    // Only presents that follow another one contribute intervals
+    Clock::time_point lastPresent_{};
+    uint64_t intervals_ = 0;
+    Clock::duration intervalSum_{};
+    Clock::duration shortestInterval_ = Clock::duration::max();
+    Clock::duration longestInterval_{};
+
+    uint64_t latencies_ = 0;
+    Clock::duration latencySum_{};
+    Clock::duration longestLatency_{};
+    bool latencyOnScreen_ = false;
+};
+
+} // namespace vulkanctx
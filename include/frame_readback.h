@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "deletion_queue.h"
+#include "vulkan_context.h"
+
+namespace vulkanctx {
+
+// Native copies the swap chain images as they are. The 4:2:0 formats are
+// converted on the GPU with BT.709 limited range coefficients, which needs a
+// width that is a multiple of 8 and an even height.
+enum class ReadbackFormat { Native, NV12, I420 };
+
+// A frame copied back to host memory, only valid during the consumer call.
+// Rows are tightly packed and rowPitch is the size of a luma row for the
+// 4:2:0 formats, whose chroma planes follow the luma plane. Those are
+// reported as VK_FORMAT_G8_B8R8_2PLANE_420_UNORM (NV12) and
+// VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM (I420).
+struct ReadbackFrame {
+    uint64_t frame;
+    VkExtent2D extent;
+    VkFormat format;
+    const uint8_t *data;
+    VkDeviceSize rowPitch;
+    VkDeviceSize size;
+};
+
+using ReadbackConsumer = std::function<void(const ReadbackFrame &)>;
+
+// Copies every rendered frame out of the swap chain into a ring of host
+// cached buffers, one per frame in flight. A slot is handed to the consumer
+// when drawFrame waits on its fence again, so the CPU reads frame N - k while
+// the GPU is busy with the frames after it and the copy never holds up the
+// render loop. The consumer runs on the thread calling drawFrame.
+class FrameReadback {
+  public:
+    FrameReadback(
+        const VkDevice &device,
+        const VkPhysicalDevice &physicalDevice,
+        const VkCommandPool &commandPool,
+        const uint32_t &slotCount,
+        ReadbackConsumer consumer,
+        const ReadbackFormat &readbackFormat = ReadbackFormat::Native);
+
+    FrameReadback(const FrameReadback &) = delete;
+    auto operator=(const FrameReadback &) -> FrameReadback & = delete;
+
+    // Records the copies for the current swap chain and has to be called
+    // again after every recreation. Whatever was built for the previous swap
+    // chain is retired through the deletion queue, and frames still in flight
+    // at that point are dropped.
+    auto prepare(const SwapChainResources &resources,
+                 DeletionQueue &deletionQueue,
+                 const uint64_t &lastUsedFrame) -> void;
+
+    auto commandBuffer(const uint32_t &slot, const uint32_t &imageIndex) const
+        -> VkCommandBuffer;
+
+    auto submitted(const uint32_t &slot, const uint64_t &frame) -> void;
+
+    // Passes the frame held by the slot to the consumer, if there is one. The
+    // in flight fence of the slot has to be signaled.
+    auto collect(const uint32_t &slot) -> void;
+
+    auto framesRead() const -> uint64_t;
+    auto framesDropped() const -> uint64_t;
+
+  private:
+    struct Slot {
+        Buffer buffer{};
+        void *mapped = nullptr;
+
+        // Frame whose copy the buffer receives, 0 if none is pending
+        uint64_t frame = 0;
+    };
+
+    auto createSampler() -> void;
+    auto createConversion(const bool &srgb) -> void;
+
+    auto record(const VkCommandBuffer &commandBuffer,
+                const VkImage &image,
+                const VkBuffer &buffer) const -> void;
+    auto recordConversion(const VkCommandBuffer &commandBuffer,
+                          const VkImage &image,
+                          const VkBuffer &buffer,
+                          const VkDescriptorSet &descriptorSet) const -> void;
+
+    VkDevice device_;
+    VkPhysicalDevice physicalDevice_;
+    VkCommandPool commandPool_;
+    ReadbackConsumer consumer_;
+    ReadbackFormat readbackFormat_;
+
+    // Only used by the 4:2:0 formats. The descriptor sets, one per slot and
+    // swap chain image like the command buffers, are rebuilt by prepare(),
+    // as is the pipeline when the swap chain switches between sRGB and UNORM.
+    UniqueSampler sampler_;
+    ComputePipeline conversion_{};
+    bool conversionSrgb_ = false;
+    UniqueDescriptorPool descriptorPool_;
+
+    std::vector<Slot> slots_;
+
+    // One per slot and swap chain image, slot major
+    std::vector<UniqueCommandBuffer> commandBuffers_;
+    uint32_t imageCount_ = 0;
+
+    VkExtent2D extent_{};
+    VkFormat format_ = VK_FORMAT_UNDEFINED;
+    VkDeviceSize rowPitch_ = 0;
+
+    uint64_t framesRead_ = 0;
+    uint64_t framesDropped_ = 0;
+};
+
+} // namespace vulkanctx
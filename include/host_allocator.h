@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace vulkanctx {
+
+// VkSystemAllocationScope runs from COMMAND (0) to INSTANCE (4)
+constexpr size_t allocationScopeCount = 5;
+
+struct HostAllocationStatistics {
+    uint64_t allocations = 0;
+    uint64_t reallocations = 0;
+    uint64_t frees = 0;
+    uint64_t liveBytes = 0;
+    uint64_t peakBytes = 0;
+    uint64_t pooledAllocations = 0;
+};
+
+using HostAllocationSnapshot =
+    std::array<HostAllocationStatistics, allocationScopeCount>;
+
+// Host allocator for the Vulkan driver. Requests of up to 2 KiB with at most
+// 16 byte alignment are served from size class pools, fronted by a cache per
+// thread so that the common path takes no lock. Larger or over-aligned
+// requests go to aligned_alloc. Every call is accounted to the allocation
+// scope the driver passed in.
+class HostAllocator {
+  public:
+    HostAllocator();
+
+    HostAllocator(const HostAllocator &) = delete;
+    auto operator=(const HostAllocator &) -> HostAllocator & = delete;
+
+    auto callbacks() const -> const VkAllocationCallbacks *;
+
+    auto snapshot() const -> HostAllocationSnapshot;
+
+    // Prints the counters per scope. If a baseline is given, the calls are
+    // reported relative to it, which is how churn of a single operation such
+    // as a swap chain recreation is measured.
+    auto report(std::ostream &stream,
+                const HostAllocationSnapshot *baseline = nullptr) const
+        -> void;
+
+  private:
+    struct Counters {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> reallocations{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> liveBytes{0};
+        std::atomic<uint64_t> peakBytes{0};
+        std::atomic<uint64_t> pooledAllocations{0};
+    };
+
+    static auto VKAPI_CALL allocate(void *userDataPtr,
+                                    size_t size,
+                                    size_t alignment,
+                                    VkSystemAllocationScope scope) -> void *;
+    static auto VKAPI_CALL reallocate(void *userDataPtr,
+                                      void *originalPtr,
+                                      size_t size,
+                                      size_t alignment,
+                                      VkSystemAllocationScope scope)
+        -> void *;
+    static auto VKAPI_CALL free(void *userDataPtr, void *memoryPtr) -> void;
+
+    auto countAllocation(VkSystemAllocationScope scope,
+                         size_t size,
+                         bool pooled) -> void;
+    auto countFree(VkSystemAllocationScope scope, size_t size) -> void;
+    static auto addLiveBytes(Counters &counters, size_t size) -> void;
+
+    VkAllocationCallbacks callbacks_;
+    std::array<Counters, allocationScopeCount> counters_;
+};
+
+// The allocation callbacks passed to every vkCreate* and vkDestroy* call made
+// by vulkanctx. Defaults to a process wide HostAllocator; pass nullptr to fall
+// back to the driver's own allocator. Has to be set before createInstance and
+// left alone until cleanup has returned.
+auto hostAllocator() -> const VkAllocationCallbacks *;
+auto setHostAllocator(const VkAllocationCallbacks *allocator) -> void;
+
+auto defaultHostAllocator() -> HostAllocator &;
+
+} // namespace vulkanctx
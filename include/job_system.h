@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace vulkanctx {
+
+// Tracks the jobs of one fork/join group. A job may spawn further jobs into
+// the counter it runs under; the group is done once all of them are.
+class JobCounter {
+  public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter &) = delete;
+    auto operator=(const JobCounter &) -> JobCounter & = delete;
+
+    auto done() const -> bool;
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> pending_{0};
+
+    // The first exception thrown by any job, rethrown by JobSystem::wait
+    std::mutex errorMutex_;
+    std::exception_ptr error_;
+};
+
+// Work stealing scheduler. Every worker owns a Chase-Lev deque: it pushes
+// and pops jobs at the bottom, LIFO for cache locality, while idle workers
+// steal from the top of the others. Threads that aren't workers, like the
+// main and render threads, submit through a shared injection queue instead.
+//
+// Waiting for a counter never blocks: the waiting thread runs jobs, its own
+// first, until the counter is done. Workers without work sleep on a
+// condition variable and are woken by the next spawn.
+class JobSystem {
+  public:
+    // Defaults to one worker per hardware thread besides the calling one
+    explicit JobSystem(size_t workerCount = 0);
+
+    // Finishes whatever was spawned before joining the workers
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    auto operator=(const JobSystem &) -> JobSystem & = delete;
+
+    auto spawn(JobCounter &counter, std::function<void()> function) -> void;
+
+    // Runs jobs until the counter is done, then rethrows the first exception
+    // any of its jobs threw
+    auto wait(JobCounter &counter) -> void;
+
+    // Calls body with consecutive ranges of at most grain indices out of
+    // [0, count) in parallel and returns once all of them returned
+    auto parallelFor(const size_t &count,
+                     const size_t &grain,
+                     const std::function<void(size_t, size_t)> &body) -> void;
+
+    auto workerCount() const -> size_t;
+
+  private:
+    struct Job {
+        std::function<void()> function;
+        JobCounter *counter;
+    };
+
+    // Fixed capacity, a full deque makes spawn run the job inline
+    class Deque {
+      public:
+        explicit Deque(const size_t &capacity);
+
+        auto push(Job *job) -> bool;
+        auto pop() -> Job *;
+        auto steal() -> Job *;
+
+      private:
+        std::unique_ptr<std::atomic<Job *>[]> jobs_;
+        int64_t mask_;
+
+        alignas(64) std::atomic<int64_t> top_{0};
+        alignas(64) std::atomic<int64_t> bottom_{0};
+    };
+
+    auto workerLoop(const size_t &index) -> void;
+    auto findJob(const size_t &self) -> Job *;
+    auto execute(Job *job) -> void;
+    auto notify() -> void;
+
+    std::vector<std::unique_ptr<Deque>> deques_;
+    std::vector<std::thread> workers_;
+
+    std::mutex injectedMutex_;
+    std::vector<Job *> injected_;
+    std::atomic<size_t> injectedCount_{0};
+
+    std::mutex sleepMutex_;
+    std::condition_variable wakeup_;
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<uint32_t> sleepers_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+// Process wide job system shared by the engine, created on first use. The
+// worker count can be set with VULKANCTX_JOB_THREADS.
+auto jobSystem() -> JobSystem &;
+
+// Measures the scheduling overhead per task for empty jobs spawned from the
+// calling thread, spawned by a worker into its own deque, and run through
+// parallelFor
+auto runJobBenchmark(const size_t &taskCount, std::ostream &stream) -> void;
+
+} // namespace vulkanctx
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+namespace vulkanctx {
+
+struct ObjectCounts {
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+    uint64_t live = 0;
+    uint64_t peak = 0;
+};
+
+// Counts the Vulkan objects vulkanctx owns, per VkObjectType. An object is
+// counted from when a UniqueHandle takes it over until it is destroyed,
+// either by its owner or by the deletion queue, so a handle that was
+// released and then dropped stays live and shows up as a leak.
+//
+// Non-release builds also keep the file and line where every live object
+// was taken over, which is usually right below the vkCreate* call, and list
+// them for whatever is left at exit.
+class ObjectTracker {
+  public:
+    ObjectTracker() = default;
+
+    ObjectTracker(const ObjectTracker &) = delete;
+    auto operator=(const ObjectTracker &) -> ObjectTracker & = delete;
+
+    auto created(const VkObjectType &type,
+                 const uint64_t &handle,
+                 const char *file,
+                 const int &line) -> void;
+    auto destroyed(const VkObjectType &type, const uint64_t &handle) -> void;
+
+    auto counts(const VkObjectType &type) const -> ObjectCounts;
+    auto live() const -> uint64_t;
+
+    // Peak and live counts of every type seen
+    auto report(std::ostream &stream) const -> void;
+
+    // Lists the objects still alive, with where they were created if that
+    // was recorded. Returns how many there are.
+    auto reportLeaks(std::ostream &stream) const -> uint64_t;
+
+  private:
+    struct Site {
+        const char *file;
+        int line;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<VkObjectType, ObjectCounts> counts_;
+
+    // Non-dispatchable handles needn't be unique, even within a type
+    std::multimap<std::pair<VkObjectType, uint64_t>, Site> sites_;
+};
+
+auto objectTracker() -> ObjectTracker &;
+
+// Lower case and readable, e.g. "image view"
+auto objectTypeName(const VkObjectType &type) -> const char *;
+
+template <typename Handle> auto objectHandle(const Handle &handle) -> uint64_t {
+    if constexpr (std::is_pointer_v<Handle>) {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+    } else {
+        return static_cast<uint64_t>(handle);
+    }
+}
+
+} // namespace vulkanctx
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vulkanctx {
+
+// Gathers the work any number of producers put on one queue during a frame
+// and hands it to the driver in a single vkQueueSubmit2. The work is grouped
+// into batches, one VkSubmitInfo2 each: the waits of a batch hold back all of
+// its command buffers, which run in the order they were added, and its
+// signals follow all of them.
+//
+// The arrays are kept between flushes, so a steady frame loop doesn't
+// allocate once they have grown to fit.
+class SubmissionBuilder {
+  public:
+    SubmissionBuilder();
+
+    // The value is only used for timeline semaphores
+    auto wait(const VkSemaphore &semaphore,
+              const VkPipelineStageFlags2 &stageMask,
+              const uint64_t &value = 0) -> void;
+    auto add(const VkCommandBuffer &commandBuffer) -> void;
+    auto signal(const VkSemaphore &semaphore,
+                const VkPipelineStageFlags2 &stageMask,
+                const uint64_t &value = 0) -> void;
+
+    // Closes the current batch, so that what is added afterwards neither
+    // waits for its semaphores nor delays its signals. Does nothing if the
+    // batch is still empty.
+    auto nextBatch() -> void;
+
+    auto empty() const -> bool;
+
+    // Submits everything added since the last flush and starts over. Without
+    // synchronization2 the batches go through vkQueueSubmit instead, which
+    // only understands the stages that existed before it.
+    auto flush(const VkQueue &queue, const VkFence &fence = VK_NULL_HANDLE)
+        -> VkResult;
+
+  private:
+    // Where the batch starts in each of the arrays, it ends where the next
+    // one starts
+    struct Batch {
+        size_t firstWait;
+        size_t firstCommandBuffer;
+        size_t firstSignal;
+
+        auto operator==(const Batch &other) const -> bool;
+    };
+
+    auto batchEnd(const size_t &index) const -> Batch;
+
+    // Number of batches with anything in them
+    auto batchCount() const -> size_t;
+
+    auto submitLegacy(const VkQueue &queue, const VkFence &fence) -> VkResult;
+
+    std::vector<VkSemaphoreSubmitInfo> waits_;
+    std::vector<VkCommandBufferSubmitInfo> commandBuffers_;
+    std::vector<VkSemaphoreSubmitInfo> signals_;
+    std::vector<Batch> batches_;
+    std::vector<VkSubmitInfo2> submits_;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace vulkanctx {
+
+// Drives the render loop on demand: the window is only redrawn after
+// something marked it dirty, and the loop otherwise sleeps instead of
+// acquiring, submitting and presenting the same image again. It sleeps at
+// most for the idle timeout, so that the loop still gets to housekeeping.
+//
+// Anything that renders every frame regardless, like readback or async
+// compute, should set the scheduler continuous.
+class RedrawScheduler {
+  public:
+    // The first frame is always drawn
+    explicit RedrawScheduler(const std::chrono::milliseconds &idleTimeout);
+
+    RedrawScheduler(const RedrawScheduler &) = delete;
+    auto operator=(const RedrawScheduler &) -> RedrawScheduler & = delete;
+
+    // Safe to call from any thread, wakes the loop if it is waiting
+    auto markDirty() -> void;
+
+    // Wakes the loop without asking for a frame, e.g. for new events
+    auto wake() -> void;
+
+    auto setContinuous(const bool &continuous) -> void;
+    auto continuous() const -> bool;
+
+    // Waits until the window is dirty, wake() is called or the idle timeout
+    // passes, and returns whether a frame should be drawn. Every call that
+    // returns false counts as a skipped frame.
+    auto waitForFrame() -> bool;
+
+    // Waits until wake() or markDirty() is called or the idle timeout
+    // passes, continuous or not. For when there is nothing that could be
+    // drawn, e.g. while every window is minimized.
+    auto waitForEvent() -> void;
+
+    auto framesDrawn() const -> uint64_t;
+    auto framesSkipped() const -> uint64_t;
+
+    auto report(std::ostream &stream) const -> void;
+
+  private:
+    std::chrono::milliseconds idleTimeout_;
+    bool continuous_ = false;
+    std::atomic<bool> dirty_{true};
+
+    std::mutex mutex_;
+    std::condition_variable woken_;
+    bool wakePending_ = false;
+
+    uint64_t framesDrawn_ = 0;
+    uint64_t framesSkipped_ = 0;
+};
+
+} // namespace vulkanctx
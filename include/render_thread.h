@@ -0,0 +1,112 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "redraw_scheduler.h"
+#include "spsc_queue.h"
+
+namespace vulkanctx {
+
+struct WindowEvent {
+    enum class Type {
+        FramebufferResize,
+        Refresh,
+        Iconify,
+        Restore,
+        Key,
+        MouseButton,
+        CursorMove,
+    };
+
+    Type type;
+
+    // Index of the window the event belongs to
+    size_t window = 0;
+
+    // Framebuffer size, key or button with action and modifiers
+    int width = 0;
+    int height = 0;
+    int code = 0;
+    int action = 0;
+    int mods = 0;
+
+    double x = 0.0;
+    double y = 0.0;
+};
+
+// Moves the render loop off the thread that owns GLFW. The main thread only
+// pumps events in run(): the window callbacks forward them through a SPSC
+// queue and wake the scheduler, so neither side ever waits for the other.
+// Exposure, resizes and restoring a window mark the scheduler dirty.
+//
+// The framebuffer sizes are also published separately, so a resize is never
+// lost to a full queue. The render thread should take them from
+// framebufferSize() once it sees a FramebufferResize event, as GLFW may not
+// be called from there.
+class RenderThread {
+  public:
+    // Takes over the user pointer and callbacks of every window. Events are
+    // tagged with the index of their window in windows.
+    RenderThread(const std::vector<GLFWwindow *> &windows,
+                 RedrawScheduler &scheduler,
+                 const size_t &queueCapacity = 1024);
+
+    // Stops and joins the thread if run() didn't
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+    auto operator=(const RenderThread &) -> RenderThread & = delete;
+
+    // Runs loop on the render thread and pumps events on the calling thread
+    // until any of the windows should close or loop returns. Rethrows
+    // whatever the loop threw.
+    auto run(std::function<void()> loop) -> void;
+
+    // Has run() call tick between events, at least every interval, for
+    // whatever has to drive GLFW from the pumping thread
+    auto setTick(std::function<void()> tick,
+                 const std::chrono::milliseconds &interval) -> void;
+
+    // Render thread side
+    auto stopRequested() const -> bool;
+    auto pollEvent() -> std::optional<WindowEvent>;
+    auto framebufferSize(const size_t &window) const -> VkExtent2D;
+
+    auto eventsDropped() const -> uint64_t;
+
+  private:
+    static auto of(GLFWwindow *window) -> RenderThread *;
+
+    // Fills in the window of the event
+    auto push(GLFWwindow *window, WindowEvent event) -> void;
+    auto shouldClose() const -> bool;
+    auto stop() -> void;
+
+    std::vector<GLFWwindow *> windows_;
+    RedrawScheduler &scheduler_;
+    std::function<void()> tick_;
+    std::chrono::milliseconds tickInterval_{};
+    SpscQueue<WindowEvent> events_;
+
+    // Width in the high and height in the low half, one per window
+    std::unique_ptr<std::atomic<uint64_t>[]> framebufferSizes_;
+
+    std::atomic<bool> stopRequested_{false};
+    std::atomic<bool> finished_{false};
+    std::atomic<uint64_t> eventsDropped_{0};
+    std::exception_ptr error_;
+    std::thread thread_;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkanctx {
+
+// How the commands recorded next use a resource. The layout only applies to
+// images.
+struct ResourceUse {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+// Derives the barriers between uses of images and buffers from the last
+// layout, stages and accesses recorded for every image subresource and
+// buffer. Each barrier waits for exactly the stages that wrote or read the
+// resource since the last write, and makes writes visible to exactly the
+// accesses that come next. Reads that already waited for the last write
+// cost nothing.
+//
+// Uses are declared before the commands that make them and the resulting
+// barriers are recorded by flush, all in one vkCmdPipelineBarrier2. Barriers
+// of neighbouring subresources that ended up identical are merged into one.
+//
+// States follow recording order, so one tracker serves command buffers that
+// are submitted in the order they were recorded. Queue family ownership
+// transfers aren't covered.
+class ResourceStateTracker {
+  public:
+    // Starts tracking a resource. current is what it was last synchronized
+    // for: commands at those stages may use it with those accesses without
+    // further barriers. Freshly created resources have no stages and an
+    // undefined layout.
+    auto trackImage(const VkImage &image,
+                    const VkImageAspectFlags &aspectMask,
+                    const uint32_t &levelCount,
+                    const uint32_t &layerCount,
+                    const ResourceUse &current) -> void;
+    auto trackBuffer(const VkBuffer &buffer, const ResourceUse &current)
+        -> void;
+
+    // Must be called before a tracked resource is destroyed, as the handle
+    // may be reused
+    auto forget(const VkImage &image) -> void;
+    auto forget(const VkBuffer &buffer) -> void;
+
+    // A resource may only be used once between flushes, as the barriers of
+    // a single call aren't ordered against each other
+    auto useImage(const VkImage &image, const ResourceUse &use) -> void;
+    auto useImage(const VkImage &image,
+                  const VkImageSubresourceRange &range,
+                  const ResourceUse &use) -> void;
+    auto useBuffer(const VkBuffer &buffer, const ResourceUse &use) -> void;
+
+    // Records the barriers the uses since the last flush need, if any
+    auto flush(const VkCommandBuffer &commandBuffer) -> void;
+
+  private:
+    struct State {
+        VkImageLayout layout;
+
+        // The last write, or layout transition, and the reads since then.
+        // All of those reads waited for the write and had it made visible.
+        VkPipelineStageFlags2 writeStages;
+        VkAccessFlags2 writeAccess;
+        VkPipelineStageFlags2 readStages;
+        VkAccessFlags2 readAccess;
+
+        // Flush the state was last used in
+        uint64_t flush;
+    };
+
+    struct Image {
+        VkImageAspectFlags aspectMask;
+        uint32_t levelCount;
+        uint32_t layerCount;
+        std::vector<State> subresources;
+    };
+
+    static auto initialState(const ResourceUse &current) -> State;
+
+    // Fills the source half of barrier and moves the state on to use.
+    // Returns whether a barrier is needed at all.
+    auto advance(State &state,
+                 const ResourceUse &use,
+                 const bool &hasLayout,
+                 VkPipelineStageFlags2 &srcStages,
+                 VkAccessFlags2 &srcAccess) -> bool;
+
+    auto addImageBarrier(const VkImageMemoryBarrier2 &barrier) -> void;
+    auto mergeLevels() -> void;
+
+    std::unordered_map<VkImage, Image> images_;
+    std::unordered_map<VkBuffer, State> buffers_;
+
+    std::vector<VkImageMemoryBarrier2> imageBarriers_;
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers_;
+    uint64_t flushes_ = 1;
+};
+
+} // namespace vulkanctx
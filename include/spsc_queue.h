@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace vulkanctx {
+
+// Bounded lock free queue for exactly one producer thread and one consumer
+// thread. The indices only ever grow and are masked into the ring, so the
+// capacity has to be a power of two. Each side caches the other's index and
+// only reloads it when the ring looks full or empty, which keeps the shared
+// cache lines quiet while both sides make progress.
+template <typename T> class SpscQueue {
+  public:
+    explicit SpscQueue(const size_t &capacity)
+        : slots_(capacity), mask_(capacity - 1) {
+        if (capacity == 0 || (capacity & mask_) != 0) {
+            throw std::invalid_argument(
+                "SPSC queue capacity has to be a power of two");
+        }
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    auto operator=(const SpscQueue &) -> SpscQueue & = delete;
+
+    // Producer only. Returns false and drops the value if the ring is full.
+    auto push(const T &value) -> bool {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail - cachedHead_ == slots_.size()) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+
+            if (tail - cachedHead_ == slots_.size()) {
+                return false;
+            }
+        }
+
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only
+    auto pop() -> std::optional<T> {
+        const size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+
+            if (head == cachedTail_) {
+                return std::nullopt;
+            }
+        }
+
+        T value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+
+        return value;
+    }
+
+    auto capacity() const -> size_t { return slots_.size(); }
+
+  private:
+    std::vector<T> slots_;
+    size_t mask_;
+
+    // Consumer side
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cachedTail_ = 0;
+
+    // Producer side
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cachedHead_ = 0;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vulkanctx {
+
+using StartupClock = std::chrono::steady_clock;
+
+struct StartupPhase {
+    std::string name;
+    std::thread::id thread;
+    StartupClock::time_point start;
+    StartupClock::time_point end;
+};
+
+// Collects the wall clock span of every initialization phase relative to the
+// moment the profiler was constructed, which should be as early as possible in
+// main.
+class StartupProfiler {
+  public:
+    StartupProfiler();
+
+    auto record(const std::string &name,
+                const StartupClock::time_point &start,
+                const StartupClock::time_point &end) -> void;
+
+    auto origin() const -> StartupClock::time_point;
+
+    auto report(std::ostream &stream) const -> void;
+
+  private:
+    StartupClock::time_point origin_;
+    std::thread::id mainThread_;
+    mutable std::mutex mutex_;
+    std::vector<StartupPhase> phases_;
+};
+
+// A dependency graph of initialization phases. Phases with main affinity run
+// in insertion order on the thread calling run(), which is required for the
+// GLFW calls that must happen on the main thread. Worker phases start as soon
+// as all of their dependencies have finished.
+class StartupGraph {
+  public:
+    enum class Affinity { Main, Worker };
+
+    using PhaseId = size_t;
+
+    auto addPhase(const std::string &name,
+                  const std::vector<PhaseId> &dependencies,
+                  const Affinity &affinity,
+                  std::function<void()> function) -> PhaseId;
+
+    // Runs every phase and rethrows the first exception raised by any of them
+    // once all phases have either finished or been abandoned.
+    auto run(StartupProfiler &profiler) -> void;
+
+  private:
+    struct Node {
+        std::string name;
+        std::vector<PhaseId> dependencies;
+        Affinity affinity;
+        std::function<void()> function;
+    };
+
+    std::vector<Node> nodes_;
+};
+
+} // namespace vulkanctx
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace vulkanctx {
+
+// Hands the newest value from exactly one producer thread to exactly one
+// consumer thread without either ever waiting. The producer fills the back
+// slot and swaps it with the middle one, the consumer swaps the middle slot
+// with its front one whenever the producer published since. Values the
+// consumer didn't get to in time are overwritten, it always sees the latest.
+template <typename T> class TripleBuffer {
+  public:
+    TripleBuffer() = default;
+
+    explicit TripleBuffer(const T &initial) {
+        slots_.fill(initial);
+    }
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    auto operator=(const TripleBuffer &) -> TripleBuffer & = delete;
+
+    // Producer only. Holds whatever was published some time ago, so it has
+    // to be written in full before publish().
+    auto back() -> T & { return slots_[back_]; }
+
+    auto publish() -> void {
+        back_ = middle_.exchange(back_ | freshBit, std::memory_order_acq_rel) &
+                indexMask;
+    }
+
+    // Consumer only. Moves the newest published value to the front, returns
+    // whether there was one.
+    auto update() -> bool {
+        if ((middle_.load(std::memory_order_relaxed) & freshBit) == 0) {
+            return false;
+        }
+
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) &
+                 indexMask;
+
+        return true;
+    }
+
+    auto front() const -> const T & { return slots_[front_]; }
+
+  private:
+    static constexpr uint8_t indexMask = 3;
+    static constexpr uint8_t freshBit = 4;
+
+    std::array<T, 3> slots_{};
+
+    // Index of the middle slot, with freshBit set while the consumer hasn't
+    // taken it yet
+    alignas(64) std::atomic<uint8_t> middle_{1};
+
+    // Consumer side
+    alignas(64) uint8_t front_ = 0;
+
+    // Producer side
+    alignas(64) uint8_t back_ = 2;
+};
+
+} // namespace vulkanctx
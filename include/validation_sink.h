@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace vulkanctx {
+
+// Receives validation layer messages on whatever thread the driver happens to
+// call back on. Producers only copy the message into a bounded lock-free ring
+// buffer; a background thread drains it, collapses repeated message IDs into
+// counts and writes the result to the output stream. The thread sleeps until
+// a message arrives or the repeat counts are due, never polling.
+class ValidationSink {
+  public:
+    static constexpr size_t capacity = 256;
+    static constexpr size_t maxMessageLength = 2048;
+
+    explicit ValidationSink(std::ostream &stream);
+    ~ValidationSink();
+
+    ValidationSink(const ValidationSink &) = delete;
+    auto operator=(const ValidationSink &) -> ValidationSink & = delete;
+
+    auto start() -> void;
+
+    // Drains every queued message, reports outstanding repeat counts and
+    // joins the background thread
+    auto stop() -> void;
+
+    // Safe to call from any number of threads concurrently. Returns false if
+    // the message was filtered out or dropped because the buffer was full.
+    auto enqueue(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+                 VkDebugUtilsMessageTypeFlagsEXT type,
+                 const VkDebugUtilsMessengerCallbackDataEXT *callbackDataPtr)
+        -> bool;
+
+    // Messages with a severity below the given bit are discarded in the
+    // callback before they reach the buffer
+    auto setMinimumSeverity(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+        -> void;
+    auto minimumSeverity() const -> VkDebugUtilsMessageSeverityFlagBitsEXT;
+
+    auto droppedCount() const -> uint64_t;
+
+  private:
+    struct Message {
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        VkDebugUtilsMessageTypeFlagsEXT type;
+        int32_t messageId;
+        char text[maxMessageLength];
+    };
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Message message;
+    };
+
+    struct Repeat {
+        uint64_t count;
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        std::string summary;
+    };
+
+    // Wakes the draining thread, cheap unless it may be asleep
+    auto signal() -> void;
+
+    auto tryDequeue(Message &message) -> bool;
+    auto drain() -> void;
+    auto write(const Message &message) -> void;
+    auto reportRepeats() -> void;
+
+    std::ostream &stream_;
+    std::unique_ptr<Cell[]> cells_;
+
+    alignas(64) std::atomic<size_t> enqueuePosition_{0};
+    alignas(64) size_t dequeuePosition_ = 0;
+
+    std::atomic<uint32_t> minimumSeverity_;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+
+    // Set by producers after publishing a message, cleared by the draining
+    // thread before it looks for messages. The mutex only orders setting it
+    // against the thread going to sleep, so that no wakeup is lost.
+    std::atomic<bool> signaled_{false};
+    std::mutex mutex_;
+    std::condition_variable woken_;
+
+    // Only touched by the draining thread
+    std::unordered_map<uint64_t, Repeat> repeats_;
+};
+
+} // namespace vulkanctx
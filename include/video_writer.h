@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_readback.h"
+
+namespace vulkanctx {
+
+// Streams 4:2:0 frames from a FrameReadback to a file or named pipe on a
+// background thread. I420 frames are written as Y4M; NV12 has no Y4M colour
+// space and is written as raw frames instead, e.g. for an encoder reading
+// "-f rawvideo -pix_fmt nv12". There are two frame buffers, so the render
+// loop only blocks on the writer if it falls more than a frame behind.
+class VideoWriter {
+  public:
+    VideoWriter(const std::string &path, const uint32_t &frameRate);
+
+    ~VideoWriter();
+
+    VideoWriter(const VideoWriter &) = delete;
+    auto operator=(const VideoWriter &) -> VideoWriter & = delete;
+
+    // Copies the frame and returns, throws if an earlier write failed
+    auto write(const ReadbackFrame &frame) -> void;
+
+    // Writes out whatever is still queued and closes the file. Called by the
+    // destructor if it wasn't before.
+    auto finish() -> void;
+
+    auto framesWritten() const -> uint64_t;
+    auto bytesWritten() const -> uint64_t;
+
+  private:
+    struct Pending {
+        std::vector<uint8_t> data;
+        bool queued = false;
+    };
+
+    auto run() -> void;
+
+    FILE *file_;
+    uint32_t frameRate_;
+    bool headerWritten_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    Pending buffers_[2];
+    size_t nextBuffer_ = 0;
+    bool stopping_ = false;
+    bool failed_ = false;
+
+    uint64_t framesWritten_ = 0;
+    uint64_t bytesWritten_ = 0;
+
+    std::thread worker_;
+};
+
+} // namespace vulkanctx
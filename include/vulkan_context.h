@@ -4,41 +4,192 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 
+#include <functional>
+#include <optional>
+#include <string>
 #include <tuple>
 #include <vector>
 
+#include "deletion_queue.h"
+#include "device_features.h"
+#include "frame_pacing.h"
+#include "queue_submission.h"
+#include "vulkan_handle.h"
+
 namespace vulkanctx {
 
+class AsyncCompute;
+class FrameDepthController;
+class FrameReadback;
+class ValidationSink;
+
 struct SwapChain {
-    VkSwapchainKHR handle;
+    UniqueSwapchain handle;
     uint32_t count;
     VkFormat format;
     VkExtent2D extent;
+    VkImageUsageFlags usage;
 };
 
 struct GraphicsPipeline {
-    VkPipelineLayout layout;
-    VkPipeline handle;
+    UniquePipelineLayout layout;
+    UniquePipeline handle;
 };
 
-struct SynchronizationObject {
-    const uint32_t amount;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkFence> inFlightFences;
+// Set 0 of the layout is described by descriptorSetLayout, and the push
+// constants are a single range of pushConstantSize bytes at offset 0
+struct ComputePipeline {
+    UniqueDescriptorSetLayout descriptorSetLayout;
+    UniquePipelineLayout layout;
+    UniquePipeline handle;
+    uint32_t pushConstantSize;
+};
+
+// Value of the specialization constant with the given constant_id. Booleans
+// and floats are passed as their 32 bit representation.
+struct SpecializationConstant {
+    uint32_t id;
+    uint32_t value;
+};
+
+struct Buffer {
+    UniqueBuffer handle;
+    UniqueDeviceMemory memory;
+    VkDeviceSize size;
+    VkMemoryPropertyFlags properties;
+};
+
+// Everything that has to be rebuilt along with the swap chain
+struct SwapChainResources {
+    SwapChain swapChain{};
+    std::vector<VkImage> images;
+    std::vector<UniqueImageView> imageViews;
+    UniqueRenderPass renderPass;
+    GraphicsPipeline graphicsPipeline;
+    std::vector<UniqueFramebuffer> framebuffers;
+    std::vector<UniqueCommandBuffer> commandBuffers;
+};
+
+enum class FrameStatus {
+    Presented,
+
+    // Presented, but the swap chain no longer matches the surface exactly
+    Suboptimal,
+
+    // The swap chain can't be presented to anymore. The frame was either
+    // never submitted or not shown.
+    OutOfDate,
+};
+
+// How long drawFrame blocked in the last frame. The acquire is the longest
+// of any window, the present the one call for all of them, and the fence
+// includes waiting for the frames that last used the acquired images.
+struct FrameWaits {
+    FramePacing::Clock::duration fence{};
+    FramePacing::Clock::duration acquire{};
+    FramePacing::Clock::duration present{};
+};
+
+// A window and its swap chain. The command pool is the window's own, so the
+// command buffers of different windows can be recorded on different threads.
+struct PresentTarget {
+    UniqueSurface surface;
+    UniqueCommandPool commandPool;
+    SwapChainResources resources;
+
+    // One per frame in flight, signaled by the acquire of that frame
+    std::vector<UniqueSemaphore> imageAvailableSemaphores;
+
+    // In flight fence of the frame last drawn to each swap chain image
     std::vector<VkFence> imagesInFlight;
+
+    // Kept by the render loop: stale swap chains are recreated before the
+    // next frame and paused windows, e.g. minimized ones, are left out
+    bool stale = false;
+    bool paused = false;
+
+    // Of the last frame that included the window
+    FrameStatus status = FrameStatus::Presented;
+    FramePacing pacing{};
+
+    // Id of the last present, counting up across swap chains, and when the
+    // input of its frame was sampled. Pending while waitForPresents still
+    // has to see it on screen.
+    uint64_t presentId = 0;
+    FramePacing::Clock::time_point presentInput{};
+    bool presentPending = false;
 };
 
-auto setupDebugMessenger(const VkInstance &instance)
-    -> VkDebugUtilsMessengerEXT;
+struct SynchronizationObject {
+    // Frames in flight, changed between frames by resizeFramesInFlight
+    uint32_t amount;
+    std::vector<UniqueSemaphore> renderFinishedSemaphores;
+    std::vector<UniqueFence> inFlightFences;
+
+    // Frames are numbered from 1 in submission order. fenceFrames holds the
+    // frame last submitted with each in flight fence, retiredFrame the newest
+    // frame whose fence has been seen signaled.
+    std::vector<uint64_t> fenceFrames;
+    uint64_t submittedFrame = 0;
+    uint64_t retiredFrame = 0;
+
+    // Graphics queue work of the frame being prepared. Other subsystems add
+    // theirs before drawFrame, which adds the frame's own and submits all of
+    // it at once with the in flight fence.
+    SubmissionBuilder submission{};
+
+    // Acquires as late as possible and, where present wait is enabled, has
+    // frames wait on screen in waitForPresents, trading throughput for
+    // latency
+    bool lowLatency = false;
+
+    // The windows acquired for the frame and the arrays of its present,
+    // kept so that drawing doesn't allocate
+    std::vector<PresentTarget *> presentTargets{};
+    std::vector<VkSwapchainKHR> presentSwapChains{};
+    std::vector<uint32_t> presentImageIndices{};
+    std::vector<VkResult> presentResults{};
+    std::vector<uint64_t> presentIds{};
+
+    FrameWaits waits{};
+};
 
-auto createInstance(const char *application_name) -> VkInstance;
-auto createSurface(const VkInstance &instance, GLFWwindow *window)
-    -> VkSurfaceKHR;
+// Functions creating objects for the caller to own take the file and line
+// they are called from and hand them to the UniqueHandle constructor. Leaks
+// reported by ObjectTracker and the objects' automatic names then point at
+// the code that asked for the object, rather than at the helper.
+
+auto setupDebugMessenger(const VkInstance &instance,
+                         const char *file = __builtin_FILE(),
+                         const int &line = __builtin_LINE())
+    -> UniqueDebugMessenger;
+
+// Process wide destination of validation layer messages. Its severity filter
+// can be changed at any time while the application is running.
+auto validationSink() -> ValidationSink &;
+
+// Headless instances skip the window system extensions. Both ask for the
+// instanceApiVersion, the external memory, device ID and feature queries
+// need at least 1.1.
+auto createInstance(const char *application_name,
+                    const bool &headless = false,
+                    const char *file = __builtin_FILE(),
+                    const int &line = __builtin_LINE()) -> UniqueInstance;
+auto createSurface(const VkInstance &instance,
+                   GLFWwindow *window,
+                   const char *file = __builtin_FILE(),
+                   const int &line = __builtin_LINE()) -> UniqueSurface;
 auto pickPhysicalDevice(const VkInstance &instance, const VkSurfaceKHR &surface)
     -> VkPhysicalDevice;
-auto createLogicalDevice(const VkPhysicalDevice &physicalDevice,
-                         const VkSurfaceKHR &surface) -> VkDevice;
+
+// Enables whatever the device supports of requestedFeatures and records it
+// as the enabledDeviceFeatures
+auto createLogicalDevice(
+    const VkPhysicalDevice &physicalDevice,
+    const VkSurfaceKHR &surface,
+    const DeviceFeatures &requestedFeatures = allDeviceFeatures(),
+    const char *file = __builtin_FILE(),
+    const int &line = __builtin_LINE()) -> UniqueDevice;
 
 auto getGraphicsQueue(const VkDevice &device,
                       const VkPhysicalDevice &physicalDevice,
@@ -47,73 +198,217 @@ auto getPresentQueue(const VkDevice &device,
                      const VkPhysicalDevice &physicalDevice,
                      const VkSurfaceKHR &surface) -> VkQueue;
 
+// Whether the present queue picked for surface can present to other as well,
+// which presenting several windows at once needs
+auto sharesPresentQueue(const VkPhysicalDevice &physicalDevice,
+                        const VkSurfaceKHR &surface,
+                        const VkSurfaceKHR &other) -> bool;
+
+// Prefers a family without graphics support, then a second queue of the
+// graphics family, and shares the graphics queue if there is neither
+auto getComputeQueue(const VkDevice &device,
+                     const VkPhysicalDevice &physicalDevice,
+                     const VkSurfaceKHR &surface) -> VkQueue;
+
+auto graphicsQueueFamily(const VkPhysicalDevice &physicalDevice,
+                         const VkSurfaceKHR &surface) -> uint32_t;
+auto computeQueueFamily(const VkPhysicalDevice &physicalDevice,
+                        const VkSurfaceKHR &surface) -> uint32_t;
+
+auto findMemoryType(const VkPhysicalDevice &physicalDevice,
+                    const uint32_t &typeFilter,
+                    const VkMemoryPropertyFlags &properties)
+    -> std::optional<uint32_t>;
+
+// Allocates from the first of the preferred property sets that the device
+// offers for the buffer
+auto createBuffer(const VkDevice &device,
+                  const VkPhysicalDevice &physicalDevice,
+                  const VkDeviceSize &size,
+                  const VkBufferUsageFlags &usage,
+                  const std::vector<VkMemoryPropertyFlags> &preferredProperties,
+                  const char *file = __builtin_FILE(),
+                  const int &line = __builtin_LINE()) -> Buffer;
+
+// framebufferSize is only used if the surface leaves the extent up to the
+// swap chain. It is passed in as GLFW may only be asked on the main thread.
 auto createSwapChain(const VkDevice &device,
                      const VkPhysicalDevice &physicalDevice,
                      const VkSurfaceKHR &surface,
-                     GLFWwindow *glfwWindowPtr) -> SwapChain;
+                     const VkExtent2D &framebufferSize,
+                     const VkSwapchainKHR &oldSwapChain = VK_NULL_HANDLE,
+                     const char *file = __builtin_FILE(),
+                     const int &line = __builtin_LINE()) -> SwapChain;
 
 auto retriveSwapChainImages(const VkDevice &device,
                             const VkSwapchainKHR &swapChain,
                             uint32_t &imageCount) -> std::vector<VkImage>;
 auto createImageViews(const VkDevice &device,
                       const std::vector<VkImage> &swapChainImages,
-                      const VkFormat &swapChainImageFormat)
-    -> std::vector<VkImageView>;
+                      const VkFormat &swapChainImageFormat,
+                      const char *file = __builtin_FILE(),
+                      const int &line = __builtin_LINE())
+    -> std::vector<UniqueImageView>;
 
-auto createRenderPass(const VkDevice &device, const VkFormat &swapChainFormat)
-    -> VkRenderPass;
+auto readShaderFile(const std::string &fileName) -> std::vector<char>;
+auto createShaderModule(const VkDevice &device,
+                        const std::vector<char> &code,
+                        const char *file = __builtin_FILE(),
+                        const int &line = __builtin_LINE())
+    -> UniqueShaderModule;
+
+auto createRenderPass(
+    const VkDevice &device,
+    const VkFormat &swapChainFormat,
+    const VkImageLayout &finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+    const char *file = __builtin_FILE(),
+    const int &line = __builtin_LINE()) -> UniqueRenderPass;
+auto createGraphicsPipeline(const VkDevice &device,
+                            const VkRenderPass &renderPass,
+                            const VkExtent2D &swapChainExtent,
+                            const char *file = __builtin_FILE(),
+                            const int &line = __builtin_LINE())
+    -> vulkanctx::GraphicsPipeline;
 auto createGraphicsPipeline(const VkDevice &device,
                             const VkRenderPass &renderPass,
-                            const VkExtent2D &swapChainExtent)
+                            const VkExtent2D &swapChainExtent,
+                            const std::vector<char> &vertexShaderCode,
+                            const std::vector<char> &fragmentShaderCode,
+                            const char *file = __builtin_FILE(),
+                            const int &line = __builtin_LINE())
     -> vulkanctx::GraphicsPipeline;
 
+// Binding i of set 0 is a single descriptor of type bindings[i]
+auto createComputePipeline(
+    const VkDevice &device,
+    const std::vector<char> &shaderCode,
+    const std::vector<VkDescriptorType> &bindings,
+    const uint32_t &pushConstantSize = 0,
+    const std::vector<SpecializationConstant> &specialization = {},
+    const char *file = __builtin_FILE(),
+    const int &line = __builtin_LINE()) -> ComputePipeline;
+
 auto createFramebuffers(const VkDevice &device,
                         const VkRenderPass &renderPass,
-                        const std::vector<VkImageView> &swapChainImageViews,
-                        const VkExtent2D &swapChainExtent)
-    -> std::vector<VkFramebuffer>;
+                        const std::vector<UniqueImageView> &swapChainImageViews,
+                        const VkExtent2D &swapChainExtent,
+                        const char *file = __builtin_FILE(),
+                        const int &line = __builtin_LINE())
+    -> std::vector<UniqueFramebuffer>;
 
 auto createCommandPool(const VkDevice &device,
                        const VkPhysicalDevice &physicalDevice,
-                       const VkSurfaceKHR &surface) -> VkCommandPool;
+                       const VkSurfaceKHR &surface,
+                       const char *file = __builtin_FILE(),
+                       const int &line = __builtin_LINE()) -> UniqueCommandPool;
 auto createCommandBuffers(
     const VkDevice &device,
     const VkExtent2D &swapChainExtent,
     const VkRenderPass &renderPass,
     const VkPipeline &graphicsPipeline,
     const VkCommandPool &commandPool,
-    const std::vector<VkFramebuffer> &swapChainFramebuffers)
-    -> std::vector<VkCommandBuffer>;
+    const std::vector<UniqueFramebuffer> &swapChainFramebuffers,
+    const char *file = __builtin_FILE(),
+    const int &line = __builtin_LINE()) -> std::vector<UniqueCommandBuffer>;
+
+// Number of workgroups needed to cover count invocations
+auto groupCount(const uint32_t &count, const uint32_t &groupSize) -> uint32_t;
+
+// Both bind the pipeline with its descriptor set and, if the pipeline has
+// any, push pushConstants, which has to point to pushConstantSize bytes
+auto recordDispatch(const VkCommandBuffer &commandBuffer,
+                    const ComputePipeline &pipeline,
+                    const VkDescriptorSet &descriptorSet,
+                    const void *pushConstants,
+                    const VkExtent3D &groupCounts) -> void;
+
+// The arguments are a VkDispatchIndirectCommand at offset in a buffer with
+// VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT. If an earlier dispatch writes them,
+// it has to be followed by a barrier to VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+// at the draw indirect stage.
+auto recordDispatchIndirect(const VkCommandBuffer &commandBuffer,
+                            const ComputePipeline &pipeline,
+                            const VkDescriptorSet &descriptorSet,
+                            const void *pushConstants,
+                            const VkBuffer &buffer,
+                            const VkDeviceSize &offset) -> void;
+
+// Records a one-off command buffer from the pool, submits it and waits for
+// it to finish. Meant for work outside the frame loop, such as preprocessing
+// data before the first frame.
+auto submitImmediate(
+    const VkDevice &device,
+    const VkQueue &queue,
+    const VkCommandPool &commandPool,
+    const std::function<void(const VkCommandBuffer &)> &record) -> void;
 
+// One per frame in flight slot from firstSlot on, named "<name> <slot>"
+auto createSemaphores(const VkDevice &device,
+                      const uint32_t &count,
+                      const char *name,
+                      const uint32_t &firstSlot = 0,
+                      const char *file = __builtin_FILE(),
+                      const int &line = __builtin_LINE())
+    -> std::vector<UniqueSemaphore>;
 auto createSynchronizationObject(const VkDevice &device,
                                  const uint32_t &amount,
-                                 const uint32_t &swapChainImagesSize)
+                                 const char *file = __builtin_FILE(),
+                                 const int &line = __builtin_LINE())
     -> SynchronizationObject;
 
+// Acquires an image of every target that isn't paused, submits the frame's
+// work once and presents all of the acquired swap chains with a single
+// vkQueuePresentKHR. Targets whose acquire fails are left out of the frame.
+// Readback copies the first target only. inputTime is when the input the
+// frame shows was sampled, depth gets the CPU and GPU time of the frame.
+//
+// Each target's status tells how its frame went. Neither of the statuses
+// besides Presented is an error, the caller is expected to recreate the
+// target's swap chain before the next frame.
 auto drawFrame(const VkDevice &device,
-               const vulkanctx::SwapChain &swapChain,
-               const std::vector<VkCommandBuffer> &commandBuffers,
+               std::vector<PresentTarget> &targets,
                const VkQueue &graphicsQueue,
                const VkQueue &presentQueue,
                SynchronizationObject &synchronizationObject,
-               const uint32_t &currentFrame) -> void;
+               const uint32_t &currentFrame,
+               const FramePacing::Clock::time_point &inputTime,
+               FrameReadback *readback = nullptr,
+               AsyncCompute *compute = nullptr,
+               FrameDepthController *depth = nullptr) -> void;
 
+// Waits until the last frame presented to each target is on screen, so that
+// the next one samples its input only once the display is ready for it and
+// the CPU stays a single frame ahead. Meant for the low latency mode, and
+// does nothing without present wait.
+auto waitForPresents(const VkDevice &device,
+                     std::vector<PresentTarget> &targets) -> void;
+
+// Builds a new swap chain from the old one and hands the replaced resources
+// to the deletion queue, tagged with the last submitted frame
 auto recreateSwapChain(const VkDevice &device,
                        const VkPhysicalDevice &physicalDevice,
-                       const VkSurfaceKHR &surface,
-                       GLFWwindow *glfwWindowPtr) -> void;
-
-auto cleanup(const VkInstance &instance,
-             const VkDevice &device,
-             const VkSurfaceKHR &surface,
-             const VkSwapchainKHR &swapChain,
-             const std::vector<VkImageView> &swapChainImageViews,
-             const VkRenderPass &renderPass,
-             const VkPipelineLayout &pipelineLayout,
-             const VkPipeline &pipeline,
-             const std::vector<VkFramebuffer> &frambuffers,
-             const VkCommandPool &commandPool,
-             const SynchronizationObject &synchronizationObject,
-             const VkDebugUtilsMessengerEXT &debugMessenger) -> void;
+                       const VkExtent2D &framebufferSize,
+                       PresentTarget &target,
+                       SynchronizationObject &synchronizationObject,
+                       DeletionQueue &deletionQueue) -> void;
+
+// Changes how many frames may be in flight. Meant to be called between
+// frames, when the next one would go to slot 0, so that the slots hold
+// frames from oldest to newest. Added slots are ready right away.
+//
+// Removed slots hold the newest frames, so shrinking waits for every frame
+// in flight, and for the present queue to go idle as the presents of those
+// frames wait on the removed semaphores. The readback, compute and depth
+// slots are then collected in order, and the removed semaphores and fences
+// are retired through the deletion queue.
+auto resizeFramesInFlight(const VkDevice &device,
+                          const VkQueue &presentQueue,
+                          std::vector<PresentTarget> &targets,
+                          SynchronizationObject &synchronizationObject,
+                          const uint32_t &amount,
+                          DeletionQueue &deletionQueue,
+                          FrameReadback *readback = nullptr,
+                          AsyncCompute *compute = nullptr,
+                          FrameDepthController *depth = nullptr) -> void;
 
 } // namespace vulkanctx
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "debug_utils.h"
+#include "object_tracker.h"
+
+namespace vulkanctx {
+
+// Each traits type names a handle, its object type, the object it was created
+// from and how to destroy it. Destruction always goes through
+// vulkanctx::hostAllocator().
+struct InstanceTraits {
+    using Handle = VkInstance;
+    using Parent = std::nullptr_t;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_INSTANCE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct DebugMessengerTraits {
+    using Handle = VkDebugUtilsMessengerEXT;
+    using Parent = VkInstance;
+    static constexpr VkObjectType objectType =
+        VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct SurfaceTraits {
+    using Handle = VkSurfaceKHR;
+    using Parent = VkInstance;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_SURFACE_KHR;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct DeviceTraits {
+    using Handle = VkDevice;
+    using Parent = std::nullptr_t;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_DEVICE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct SwapchainTraits {
+    using Handle = VkSwapchainKHR;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_SWAPCHAIN_KHR;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct ImageTraits {
+    using Handle = VkImage;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_IMAGE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct ImageViewTraits {
+    using Handle = VkImageView;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_IMAGE_VIEW;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct ShaderModuleTraits {
+    using Handle = VkShaderModule;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_SHADER_MODULE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct RenderPassTraits {
+    using Handle = VkRenderPass;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_RENDER_PASS;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct PipelineLayoutTraits {
+    using Handle = VkPipelineLayout;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_PIPELINE_LAYOUT;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct PipelineTraits {
+    using Handle = VkPipeline;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_PIPELINE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct DescriptorSetLayoutTraits {
+    using Handle = VkDescriptorSetLayout;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType =
+        VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+// Destroying the pool frees every set allocated from it
+struct DescriptorPoolTraits {
+    using Handle = VkDescriptorPool;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_DESCRIPTOR_POOL;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct SamplerTraits {
+    using Handle = VkSampler;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_SAMPLER;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct FramebufferTraits {
+    using Handle = VkFramebuffer;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_FRAMEBUFFER;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct CommandPoolTraits {
+    using Handle = VkCommandPool;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_COMMAND_POOL;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct CommandBufferParent {
+    VkDevice device;
+    VkCommandPool commandPool;
+};
+
+struct CommandBufferTraits {
+    using Handle = VkCommandBuffer;
+    using Parent = CommandBufferParent;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_COMMAND_BUFFER;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct BufferTraits {
+    using Handle = VkBuffer;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_BUFFER;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+// Freeing also unmaps the memory if it is mapped
+struct DeviceMemoryTraits {
+    using Handle = VkDeviceMemory;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_DEVICE_MEMORY;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct QueryPoolTraits {
+    using Handle = VkQueryPool;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_QUERY_POOL;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct SemaphoreTraits {
+    using Handle = VkSemaphore;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_SEMAPHORE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+struct FenceTraits {
+    using Handle = VkFence;
+    using Parent = VkDevice;
+    static constexpr VkObjectType objectType = VK_OBJECT_TYPE_FENCE;
+    static auto destroy(const Parent &parent, const Handle &handle) -> void;
+};
+
+// Destroys a handle and stops counting it. Handles taken out of a
+// UniqueHandle with release() have to be destroyed this way.
+template <typename Traits>
+auto destroyHandle(const typename Traits::Parent &parent,
+                   const typename Traits::Handle &handle) -> void {
+    objectTracker().destroyed(Traits::objectType, objectHandle(handle));
+    Traits::destroy(parent, handle);
+}
+
+// Move-only owner of a single Vulkan handle. Converts implicitly to the raw
+// handle so that it can be passed straight to functions taking one.
+template <typename Traits> class UniqueHandle {
+  public:
+    using Handle = typename Traits::Handle;
+    using Parent = typename Traits::Parent;
+
+    UniqueHandle() = default;
+
+    // Counts the handle as created where the constructor is called from,
+    // see ObjectTracker, and names it after that place
+    UniqueHandle(const Parent &parent,
+                 const Handle &handle,
+                 const char *file = __builtin_FILE(),
+                 const int &line = __builtin_LINE())
+        : parent_(parent), handle_(handle) {
+        if (handle_ != VK_NULL_HANDLE) {
+            objectTracker().created(
+                Traits::objectType, objectHandle(handle_), file, line);
+
+            if constexpr (diagnosticsCompiledIn) {
+                nameCreatedObject(device(),
+                                  Traits::objectType,
+                                  objectHandle(handle_),
+                                  file,
+                                  line);
+            }
+        }
+    }
+
+    ~UniqueHandle() { reset(); }
+
+    UniqueHandle(const UniqueHandle &) = delete;
+    auto operator=(const UniqueHandle &) -> UniqueHandle & = delete;
+
+    UniqueHandle(UniqueHandle &&other) noexcept
+        : parent_(other.parent_), handle_(other.release()) {}
+
+    auto operator=(UniqueHandle &&other) noexcept -> UniqueHandle & {
+        if (this != &other) {
+            reset();
+            parent_ = other.parent_;
+            handle_ = other.release();
+        }
+
+        return *this;
+    }
+
+    auto get() const -> const Handle & { return handle_; }
+    auto parent() const -> const Parent & { return parent_; }
+
+    // See setObjectName
+    auto setName(const char *name, const int &index = -1) const -> void {
+        setObjectName(device(), Traits::objectType, handle_, name, index);
+    }
+
+    operator const Handle &() const { return handle_; }
+    explicit operator bool() const { return handle_ != VK_NULL_HANDLE; }
+
+    // Gives up ownership without destroying the handle
+    auto release() -> Handle { return std::exchange(handle_, VK_NULL_HANDLE); }
+
+    auto reset() -> void {
+        if (handle_ != VK_NULL_HANDLE) {
+            destroyHandle<Traits>(parent_, handle_);
+            handle_ = VK_NULL_HANDLE;
+        }
+    }
+
+  private:
+    // Objects of the instance can't be named through a device
+    auto device() const -> VkDevice {
+        if constexpr (std::is_same_v<Handle, VkDevice>) {
+            return handle_;
+        } else if constexpr (std::is_same_v<Parent, VkDevice>) {
+            return parent_;
+        } else if constexpr (std::is_same_v<Parent, CommandBufferParent>) {
+            return parent_.device;
+        } else {
+            return VK_NULL_HANDLE;
+        }
+    }
+
+    Parent parent_{};
+    Handle handle_ = VK_NULL_HANDLE;
+};
+
+using UniqueInstance = UniqueHandle<InstanceTraits>;
+using UniqueDebugMessenger = UniqueHandle<DebugMessengerTraits>;
+using UniqueSurface = UniqueHandle<SurfaceTraits>;
+using UniqueDevice = UniqueHandle<DeviceTraits>;
+using UniqueSwapchain = UniqueHandle<SwapchainTraits>;
+using UniqueImage = UniqueHandle<ImageTraits>;
+using UniqueImageView = UniqueHandle<ImageViewTraits>;
+using UniqueShaderModule = UniqueHandle<ShaderModuleTraits>;
+using UniqueRenderPass = UniqueHandle<RenderPassTraits>;
+using UniquePipelineLayout = UniqueHandle<PipelineLayoutTraits>;
+using UniquePipeline = UniqueHandle<PipelineTraits>;
+using UniqueDescriptorSetLayout = UniqueHandle<DescriptorSetLayoutTraits>;
+using UniqueDescriptorPool = UniqueHandle<DescriptorPoolTraits>;
+using UniqueSampler = UniqueHandle<SamplerTraits>;
+using UniqueFramebuffer = UniqueHandle<FramebufferTraits>;
+using UniqueCommandPool = UniqueHandle<CommandPoolTraits>;
+using UniqueCommandBuffer = UniqueHandle<CommandBufferTraits>;
+using UniqueBuffer = UniqueHandle<BufferTraits>;
+using UniqueDeviceMemory = UniqueHandle<DeviceMemoryTraits>;
+using UniqueQueryPool = UniqueHandle<QueryPoolTraits>;
+using UniqueSemaphore = UniqueHandle<SemaphoreTraits>;
+using UniqueFence = UniqueHandle<FenceTraits>;
+
+} // namespace vulkanctx
@@ -0,0 +1,53 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Synthetic load for the async compute queue: moves particles around the
+// attractor with a few integration substeps per frame. Nothing draws them yet,
+// they stand in for the per frame simulation a scene would run.
+layout(local_size_x = 64) in;
+
+struct Particle {
+  vec2 position;
+  vec2 velocity;
+};
+
+layout(std430, binding = 0) buffer Particles { Particle particles[]; };
+
+layout(push_constant) uniform Parameters {
+  uint count;
+  uint seed;
+
+  // Moved by the simulation thread, interpolated for the frame
+  vec2 attractor;
+} parameters;
+
+const uint substeps = 64;
+const float dt = 1.0 / (60.0 * float(substeps));
+
+void main() {
+  uint index = gl_GlobalInvocationID.x;
+
+  if (index >= parameters.count) {
+    return;
+  }
+
+  Particle particle = particles[index];
+
+  // Set on the first frame of the buffer, which saves uploading it
+  if (parameters.seed != 0) {
+    float angle = float(index) * 2.399963;
+    float radius = sqrt(float(index) / float(parameters.count));
+    particle.position = radius * vec2(cos(angle), sin(angle));
+    particle.velocity = 0.5 * vec2(-particle.position.y, particle.position.x);
+  }
+
+  for (uint step = 0; step < substeps; step++) {
+    vec2 offset = particle.position - parameters.attractor;
+    float distance = max(length(offset), 0.05);
+    vec2 acceleration = -offset / (distance * distance * distance);
+    particle.velocity += 0.1 * acceleration * dt;
+    particle.position += particle.velocity * dt;
+  }
+
+  particles[index] = particle;
+}
@@ -0,0 +1,88 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Converts the rendered frame to BT.709 limited range 4:2:0, either NV12 (a
+// luma plane followed by interleaved CbCr) or I420 (three planes). Every
+// invocation handles a block of 8x2 pixels so that it only ever writes whole
+// words, which requires the width to be a multiple of 8.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D frame;
+
+layout(std430, binding = 1) writeonly buffer Planes { uint words[]; };
+
+// I420 if set, NV12 otherwise
+layout(constant_id = 0) const bool planar = false;
+
+// Set when the frame is sampled through an sRGB view
+layout(constant_id = 1) const bool srgb = true;
+
+layout(push_constant) uniform Parameters {
+  uint width;
+  uint height;
+} parameters;
+
+// Sampling an sRGB view decodes the frame, video wants the gamma encoded
+// values back
+vec3 encodeSrgb(vec3 linear) {
+  vec3 curve = 1.055 * pow(linear, vec3(1.0 / 2.4)) - 0.055;
+  return mix(linear * 12.92, curve, step(vec3(0.0031308), linear));
+}
+
+void main() {
+  uvec2 origin = gl_GlobalInvocationID.xy * uvec2(8, 2);
+
+  if (origin.x >= parameters.width || origin.y >= parameters.height) {
+    return;
+  }
+
+  float luma[16];
+  vec2 chroma[4] = vec2[](vec2(0.0), vec2(0.0), vec2(0.0), vec2(0.0));
+
+  for (uint row = 0; row < 2; row++) {
+    for (uint column = 0; column < 8; column++) {
+      ivec2 position = ivec2(origin + uvec2(column, row));
+      vec3 rgb = texelFetch(frame, position, 0).rgb;
+
+      if (srgb) {
+        rgb = encodeSrgb(rgb);
+      }
+
+      float y = dot(rgb, vec3(0.2126, 0.7152, 0.0722));
+      luma[row * 8 + column] = (16.0 + 219.0 * y) / 255.0;
+
+      // 2x2 box filter, which sites the chroma in the centre of the block
+      vec2 difference = vec2((rgb.b - y) / 1.8556, (rgb.r - y) / 1.5748);
+      chroma[column / 2] += (128.0 + 224.0 * difference) / 255.0 * 0.25;
+    }
+  }
+
+  uint rowWords = parameters.width / 4;
+  uint lumaWords = rowWords * parameters.height;
+
+  for (uint row = 0; row < 2; row++) {
+    uint index = (origin.y + row) * rowWords + origin.x / 4;
+    uint first = row * 8;
+
+    words[index] = packUnorm4x8(vec4(luma[first], luma[first + 1],
+                                     luma[first + 2], luma[first + 3]));
+    words[index + 1] = packUnorm4x8(vec4(luma[first + 4], luma[first + 5],
+                                         luma[first + 6], luma[first + 7]));
+  }
+
+  uint chromaRow = origin.y / 2;
+
+  if (planar) {
+    uint index = chromaRow * (rowWords / 2) + origin.x / 8;
+
+    words[lumaWords + index] = packUnorm4x8(
+        vec4(chroma[0].x, chroma[1].x, chroma[2].x, chroma[3].x));
+    words[lumaWords + lumaWords / 4 + index] = packUnorm4x8(
+        vec4(chroma[0].y, chroma[1].y, chroma[2].y, chroma[3].y));
+  } else {
+    uint index = lumaWords + chromaRow * rowWords + origin.x / 4;
+
+    words[index] = packUnorm4x8(vec4(chroma[0], chroma[1]));
+    words[index + 1] = packUnorm4x8(vec4(chroma[2], chroma[3]));
+  }
+}
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+#include "async_compute.h"
+#include "debug_utils.h"
+#include "device_dispatch.h"
+#include "device_features.h"
+#include "host_allocator.h"
+
+enum TimestampQuery : uint32_t {
+    computeBeginQuery,
+    computeEndQuery,
+    graphicsBeginQuery,
+    graphicsEndQuery,
+    queriesPerSlot
+};
+
+// Stage to write the graphics begin timestamp at. Its batch waits for the
+// acquires at COLOR_ATTACHMENT_OUTPUT and for compute at consumerStage, and a
+// wait also holds back the logically later stages. With a graphics consumer
+// COLOR_ATTACHMENT_OUTPUT thus comes after both waits; otherwise it's the
+// last consumer stage, which at least waits for compute.
+static auto graphicsBeginStage(const VkPipelineStageFlags &consumerStage)
+    -> VkPipelineStageFlagBits {
+    // The stage bits up to COLOR_ATTACHMENT_OUTPUT are in pipeline order
+    constexpr VkPipelineStageFlags graphicsStages =
+        (VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT << 1) - 1;
+
+    VkPipelineStageFlags stages = consumerStage & ~graphicsStages;
+
+    if (stages == 0) {
+        return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    }
+
+    while ((stages & (stages - 1)) != 0) {
+        stages &= stages - 1;
+    }
+
+    return static_cast<VkPipelineStageFlagBits>(stages);
+}
+
+static auto createResettablePool(const VkDevice &device,
+                                 const uint32_t &queueFamily)
+    -> vulkanctx::UniqueCommandPool {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    VkCommandPool commandPool;
+    if (vulkanctx::vkCreateCommandPool(
+            device, &poolInfo, vulkanctx::hostAllocator(), &commandPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool!");
+    }
+
+    return vulkanctx::UniqueCommandPool(device, commandPool);
+}
+
+static auto allocateCommandBuffer(const VkDevice &device,
+                                  const VkCommandPool &commandPool)
+    -> vulkanctx::UniqueCommandBuffer {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vulkanctx::vkAllocateCommandBuffers(
+            device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command buffers");
+    }
+
+    return vulkanctx::UniqueCommandBuffer(
+        vulkanctx::CommandBufferParent{device, commandPool}, commandBuffer);
+}
+
+static auto createTimeline(const VkDevice &device)
+    -> vulkanctx::UniqueSemaphore {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VkSemaphore semaphore;
+    if (vulkanctx::vkCreateSemaphore(
+            device, &semaphoreInfo, vulkanctx::hostAllocator(), &semaphore) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timeline semaphore");
+    }
+
+    return vulkanctx::UniqueSemaphore(device, semaphore);
+}
+
+static auto beginRecording(const VkCommandBuffer &commandBuffer) -> void {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vulkanctx::vkBeginCommandBuffer(commandBuffer, &beginInfo) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffers.");
+    }
+}
+
+static auto endRecording(const VkCommandBuffer &commandBuffer) -> void {
+    if (vulkanctx::vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+static auto recordBarriers(
+    const VkCommandBuffer &commandBuffer,
+    const VkPipelineStageFlags &srcStage,
+    const VkPipelineStageFlags &dstStage,
+    const std::vector<VkBufferMemoryBarrier> &barriers) -> void {
+    if (barriers.empty()) {
+        return;
+    }
+
+    vulkanctx::vkCmdPipelineBarrier(commandBuffer,
+                                    srcStage,
+                                    dstStage,
+                                    0,
+                                    0,
+                                    nullptr,
+                                    static_cast<uint32_t>(barriers.size()),
+                                    barriers.data(),
+                                    0,
+                                    nullptr);
+}
+
+vulkanctx::AsyncCompute::AsyncCompute(const VkDevice &device,
+                                      const VkPhysicalDevice &physicalDevice,
+                                      const VkSurfaceKHR &surface,
+                                      const uint32_t &slotCount,
+                                      const VkPipelineStageFlags &consumerStage,
+                                      const VkAccessFlags &consumerAccess,
+                                      ComputeRecorder recorder)
+    : device_(device),
+      computeQueue_(getComputeQueue(device, physicalDevice, surface)),
+      computeFamily_(computeQueueFamily(physicalDevice, surface)),
+      graphicsFamily_(graphicsQueueFamily(physicalDevice, surface)),
+      consumerStage_(consumerStage), consumerAccess_(consumerAccess),
+      recorder_(std::move(recorder)), slots_(slotCount) {
+    if (!enabledDeviceFeatures().timelineSemaphore) {
+        throw std::runtime_error(
+            "Async compute needs timeline semaphore support");
+    }
+
+    computePool_ = createResettablePool(device_, computeFamily_);
+    graphicsPool_ = createResettablePool(device_, graphicsFamily_);
+    computeTimeline_ = createTimeline(device_);
+    graphicsTimeline_ = createTimeline(device_);
+
+    for (auto &slot : slots_) {
+        slot.compute = allocateCommandBuffer(device_, computePool_);
+        slot.graphicsBegin = allocateCommandBuffer(device_, graphicsPool_);
+        slot.graphicsEnd = allocateCommandBuffer(device_, graphicsPool_);
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    // Measuring is optional, the work runs the same without it
+    timestamps_ = queueFamilies[computeFamily_].timestampValidBits > 0 &&
+                  queueFamilies[graphicsFamily_].timestampValidBits > 0;
+    timestampPeriod_ = properties.limits.timestampPeriod;
+
+    if (timestamps_) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = slotCount * queriesPerSlot;
+
+        VkQueryPool queryPool;
+        if (vkCreateQueryPool(
+                device_, &queryPoolInfo, hostAllocator(), &queryPool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool");
+        }
+
+        queryPool_ = UniqueQueryPool(device_, queryPool);
+    }
+}
+
+auto vulkanctx::AsyncCompute::shareBuffer(const uint32_t &slot,
+                                          const VkBuffer &buffer) -> void {
+    slots_[slot].buffers.push_back(buffer);
+}
+
+auto vulkanctx::AsyncCompute::transfers(const Slot &slot,
+                                        const uint32_t &srcFamily,
+                                        const uint32_t &dstFamily,
+                                        const VkAccessFlags &srcAccess,
+                                        const VkAccessFlags &dstAccess) const
+    -> std::vector<VkBufferMemoryBarrier> {
+    std::vector<VkBufferMemoryBarrier> barriers;
+
+    // Within one family the timeline semaphores alone order the accesses
+    if (computeFamily_ == graphicsFamily_) {
+        return barriers;
+    }
+
+    for (const auto &buffer : slot.buffers) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        barriers.push_back(barrier);
+    }
+
+    return barriers;
+}
+
+auto vulkanctx::AsyncCompute::recordCompute(Slot &slot,
+                                            const uint32_t &index,
+                                            const uint64_t &frame) -> void {
+    const VkCommandBuffer &commandBuffer = slot.compute.get();
+    const uint32_t firstQuery = index * queriesPerSlot;
+
+    beginRecording(commandBuffer);
+
+    if (timestamps_) {
+        vkCmdResetQueryPool(commandBuffer,
+                            queryPool_,
+                            firstQuery + computeBeginQuery,
+                            2);
+        // The submission waits for graphics to release the slot at the
+        // compute shader stage, which the top of the pipe would run ahead of
+        vkCmdWriteTimestamp(commandBuffer,
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            queryPool_,
+                            firstQuery + computeBeginQuery);
+    }
+
+    // Acquire what the graphics frame that last used the slot released. The
+    // very first frame has nothing to acquire.
+    if (slot.graphicsOwned) {
+        recordBarriers(commandBuffer,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       transfers(slot,
+                                 graphicsFamily_,
+                                 computeFamily_,
+                                 0,
+                                 VK_ACCESS_SHADER_READ_BIT |
+                                     VK_ACCESS_SHADER_WRITE_BIT));
+    }
+
+    {
+        DebugLabel label(commandBuffer, "async compute");
+        recorder_(commandBuffer, index, frame);
+    }
+
+    recordBarriers(commandBuffer,
+                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                   transfers(slot,
+                             computeFamily_,
+                             graphicsFamily_,
+                             VK_ACCESS_SHADER_WRITE_BIT,
+                             0));
+
+    if (timestamps_) {
+        vkCmdWriteTimestamp(commandBuffer,
+                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                            queryPool_,
+                            firstQuery + computeEndQuery);
+    }
+
+    endRecording(commandBuffer);
+}
+
+auto vulkanctx::AsyncCompute::recordGraphics(Slot &slot, const uint32_t &index)
+    -> void {
+    const uint32_t firstQuery = index * queriesPerSlot;
+
+    beginRecording(slot.graphicsBegin);
+
+    if (timestamps_) {
+        vkCmdResetQueryPool(slot.graphicsBegin,
+                            queryPool_,
+                            firstQuery + graphicsBeginQuery,
+                            2);
+        vkCmdWriteTimestamp(slot.graphicsBegin,
+                            graphicsBeginStage(consumerStage_),
+                            queryPool_,
+                            firstQuery + graphicsBeginQuery);
+    }
+
+    recordBarriers(slot.graphicsBegin,
+                   consumerStage_,
+                   consumerStage_,
+                   transfers(slot,
+                             computeFamily_,
+                             graphicsFamily_,
+                             0,
+                             consumerAccess_));
+
+    endRecording(slot.graphicsBegin);
+
+    beginRecording(slot.graphicsEnd);
+
+    // Reads need no availability operation, so the release carries no access
+    recordBarriers(slot.graphicsEnd,
+                   consumerStage_,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                   transfers(slot, graphicsFamily_, computeFamily_, 0, 0));
+
+    if (timestamps_) {
+        vkCmdWriteTimestamp(slot.graphicsEnd,
+                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                            queryPool_,
+                            firstQuery + graphicsEndQuery);
+    }
+
+    endRecording(slot.graphicsEnd);
+}
+
+auto vulkanctx::AsyncCompute::submit(const uint32_t &slot,
+                                     const uint64_t &frame) -> void {
+    Slot &current = slots_[slot];
+
+    recordCompute(current, slot, frame);
+    recordGraphics(current, slot);
+
+    // The graphics frame that last used the slot's resources
+    computeSubmission_.wait(graphicsTimeline_,
+                            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                            current.lastFrame);
+    computeSubmission_.add(current.compute);
+    computeSubmission_.signal(
+        computeTimeline_, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, frame);
+
+    if (computeSubmission_.flush(computeQueue_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit compute command buffer");
+    }
+
+    // From here on the graphics frame takes the buffers and releases them
+    // again once it is done
+    current.graphicsOwned = true;
+    current.frame = frame;
+    current.lastFrame = frame;
+}
+
+auto vulkanctx::AsyncCompute::graphicsBegin(const uint32_t &slot) const
+    -> VkCommandBuffer {
+    return slots_[slot].graphicsBegin;
+}
+
+auto vulkanctx::AsyncCompute::graphicsEnd(const uint32_t &slot) const
+    -> VkCommandBuffer {
+    return slots_[slot].graphicsEnd;
+}
+
+auto vulkanctx::AsyncCompute::computeTimeline() const -> VkSemaphore {
+    return computeTimeline_;
+}
+
+auto vulkanctx::AsyncCompute::graphicsTimeline() const -> VkSemaphore {
+    return graphicsTimeline_;
+}
+
+auto vulkanctx::AsyncCompute::consumerStage() const -> VkPipelineStageFlags {
+    return consumerStage_;
+}
+
+auto vulkanctx::AsyncCompute::collect(const uint32_t &slot) -> void {
+    Slot &current = slots_[slot];
+
+    if (current.frame == 0 || !timestamps_) {
+        current.frame = 0;
+        return;
+    }
+
+    uint64_t ticks[queriesPerSlot];
+
+    if (vkGetQueryPoolResults(device_,
+                              queryPool_,
+                              slot * queriesPerSlot,
+                              queriesPerSlot,
+                              sizeof(ticks),
+                              ticks,
+                              sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        current.frame = 0;
+        return;
+    }
+
+    auto nanoseconds = [&](uint64_t begin, uint64_t end) {
+        return end > begin ? (end - begin) * timestampPeriod_ : 0.0;
+    };
+
+    uint64_t overlapBegin =
+        std::max(ticks[computeBeginQuery], ticks[graphicsBeginQuery]);
+    uint64_t overlapEnd =
+        std::min(ticks[computeEndQuery], ticks[graphicsEndQuery]);
+
+    computeNanoseconds_ +=
+        nanoseconds(ticks[computeBeginQuery], ticks[computeEndQuery]);
+    graphicsNanoseconds_ +=
+        nanoseconds(ticks[graphicsBeginQuery], ticks[graphicsEndQuery]);
+    overlapNanoseconds_ += nanoseconds(overlapBegin, overlapEnd);
+    framesMeasured_++;
+
+    current.frame = 0;
+}
+
+auto vulkanctx::AsyncCompute::report(std::ostream &stream) const -> void {
+    if (framesMeasured_ == 0) {
+        stream << "Async compute: no timestamps"
+               << (computeFamily_ == graphicsFamily_ ? " (shared family)" : "")
+               << std::endl;
+        return;
+    }
+
+    const double frames = static_cast<double>(framesMeasured_);
+    const double hidden =
+        computeNanoseconds_ > 0.0
+            ? 100.0 * overlapNanoseconds_ / computeNanoseconds_
+            : 0.0;
+
+    stream << std::fixed << std::setprecision(3)
+           << "Async compute over " << framesMeasured_ << " frames: compute "
+           << computeNanoseconds_ / frames / 1e6 << " ms, graphics "
+           << graphicsNanoseconds_ / frames / 1e6 << " ms, overlap "
+           << overlapNanoseconds_ / frames / 1e6 << " ms per frame ("
+           << std::setprecision(1) << hidden << "% of compute hidden)"
+           << (computeFamily_ == graphicsFamily_ ? ", shared family" : "")
+           << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,62 @@
+#include <cstring>
+
+#include "debug_utils.h"
+#include "device_dispatch.h"
+
+auto vulkanctx::nameObject(const VkDevice &device,
+                           const VkObjectType &type,
+                           const uint64_t &handle,
+                           const std::string &name) -> void {
+    if (vkSetDebugUtilsObjectNameEXT == nullptr || device == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkDebugUtilsObjectNameInfoEXT nameInfo{};
+    nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+    nameInfo.objectType = type;
+    nameInfo.objectHandle = handle;
+    nameInfo.pObjectName = name.c_str();
+
+    // Only fails when out of host memory, and a missing name isn't worth
+    // failing anything over
+    vkSetDebugUtilsObjectNameEXT(device, &nameInfo);
+}
+
+auto vulkanctx::nameCreatedObject(const VkDevice &device,
+                                  const VkObjectType &type,
+                                  const uint64_t &handle,
+                                  const char *file,
+                                  const int &line) -> void {
+    // Checked up front to skip building the name
+    if (vkSetDebugUtilsObjectNameEXT == nullptr) {
+        return;
+    }
+
+    const char *separator = std::strrchr(file, '/');
+    const char *basename = separator != nullptr ? separator + 1 : file;
+
+    nameObject(device,
+               type,
+               handle,
+               std::string(objectTypeName(type)) + " (" + basename + ":" +
+                   std::to_string(line) + ")");
+}
+
+auto vulkanctx::DebugLabel::begin(const char *name) -> void {
+    if (vkCmdBeginDebugUtilsLabelEXT == nullptr) {
+        return;
+    }
+
+    VkDebugUtilsLabelEXT label{};
+    label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+    label.pLabelName = name;
+
+    vkCmdBeginDebugUtilsLabelEXT(commandBuffer_, &label);
+    open_ = true;
+}
+
+auto vulkanctx::DebugLabel::end() -> void {
+    if (open_) {
+        vkCmdEndDebugUtilsLabelEXT(commandBuffer_);
+    }
+}
@@ -0,0 +1,45 @@
+#include <algorithm>
+
+#include "deletion_queue.h"
+
+vulkanctx::DeletionQueue::~DeletionQueue() { flush(); }
+
+auto vulkanctx::DeletionQueue::push(uint64_t lastUsedFrame,
+                                    std::function<void()> deleter) -> void {
+    entries_.push_back(Entry{lastUsedFrame, std::move(deleter)});
+}
+
+auto vulkanctx::DeletionQueue::collect(uint64_t retiredFrame) -> size_t {
+    size_t collected = 0;
+
+    for (auto &entry : entries_) {
+        if (entry.frame <= retiredFrame) {
+            entry.deleter();
+            entry.deleter = nullptr;
+            collected++;
+        }
+    }
+
+    if (collected > 0) {
+        entries_.erase(std::remove_if(entries_.begin(),
+                                      entries_.end(),
+                                      [](const Entry &entry) {
+                                          return !entry.deleter;
+                                      }),
+                       entries_.end());
+    }
+
+    return collected;
+}
+
+auto vulkanctx::DeletionQueue::flush() -> void {
+    for (auto &entry : entries_) {
+        entry.deleter();
+    }
+
+    entries_.clear();
+}
+
+auto vulkanctx::DeletionQueue::size() const -> size_t {
+    return entries_.size();
+}
@@ -0,0 +1,200 @@
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+
+#include "device_dispatch.h"
+#include "host_allocator.h"
+#include "vulkan_context.h"
+
+#define VULKANCTX_DEFINE_COMMAND(name) PFN_##name vulkanctx::name = nullptr;
+VULKANCTX_DEVICE_COMMANDS(VULKANCTX_DEFINE_COMMAND)
+#undef VULKANCTX_DEFINE_COMMAND
+
+auto vulkanctx::loadDeviceDispatch(const VkDevice &device) -> void {
+    // The loader's export, not one of the pointers being loaded
+#define VULKANCTX_LOAD_COMMAND(name)                                           \
+    name = reinterpret_cast<PFN_##name>(::vkGetDeviceProcAddr(device, #name));
+    VULKANCTX_DEVICE_COMMANDS(VULKANCTX_LOAD_COMMAND)
+#undef VULKANCTX_LOAD_COMMAND
+
+#define VULKANCTX_LOAD_ALIAS(name, alias)                                      \
+    if (name == nullptr) {                                                     \
+        name = reinterpret_cast<PFN_##name>(                                   \
+            ::vkGetDeviceProcAddr(device, #alias));                            \
+    }
+    VULKANCTX_DEVICE_COMMAND_ALIASES(VULKANCTX_LOAD_ALIAS)
+#undef VULKANCTX_LOAD_ALIAS
+
+    // Core commands are always there, so this only fails on a broken driver
+    if (vkQueueSubmit == nullptr || vkDestroyDevice == nullptr) {
+        throw std::runtime_error("Failed to load device commands");
+    }
+}
+
+auto vulkanctx::unloadDeviceDispatch() -> void {
+#define VULKANCTX_UNLOAD_COMMAND(name) name = nullptr;
+    VULKANCTX_DEVICE_COMMANDS(VULKANCTX_UNLOAD_COMMAND)
+#undef VULKANCTX_UNLOAD_COMMAND
+}
+
+// ---------------------------------------------------------------------------//
+//                                 Benchmark                                  //
+// ---------------------------------------------------------------------------//
+
+constexpr uint32_t barriersPerCommandBuffer = 1024;
+
+template <typename Function>
+static auto nanosecondsPerCall(const uint64_t &callCount, Function function)
+    -> double {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           static_cast<double>(callCount);
+}
+
+// Empty execution dependencies, about the cheapest command to record
+template <typename Barrier>
+static auto recordBarriers(const VkCommandBuffer &commandBuffer,
+                           const uint64_t &callCount,
+                           Barrier barrier) -> void {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    for (uint64_t recorded = 0; recorded < callCount;) {
+        vulkanctx::vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        for (uint32_t i = 0;
+             i < barriersPerCommandBuffer && recorded < callCount;
+             i++, recorded++) {
+            barrier(commandBuffer,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                    0,
+                    0,
+                    nullptr,
+                    0,
+                    nullptr,
+                    0,
+                    nullptr);
+        }
+
+        vulkanctx::vkEndCommandBuffer(commandBuffer);
+    }
+}
+
+auto vulkanctx::runDispatchBenchmark(const char *applicationName,
+                                     const uint64_t &callCount,
+                                     std::ostream &stream) -> void {
+    UniqueInstance instance = createInstance(applicationName, true);
+
+    uint32_t deviceCount = 1;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, &physicalDevice);
+
+    if (physicalDevice == VK_NULL_HANDLE) {
+        throw std::runtime_error("Failed to find GPUs with Vulkan support");
+    }
+
+    float queuePriority = 1.0f;
+
+    VkDeviceQueueCreateInfo queueCreateInfo{};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = 0;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+
+    VkDeviceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.queueCreateInfoCount = 1;
+    createInfo.pQueueCreateInfos = &queueCreateInfo;
+
+    VkDevice rawDevice;
+    if (vkCreateDevice(
+            physicalDevice, &createInfo, hostAllocator(), &rawDevice) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create logical device");
+    }
+
+    UniqueDevice device(nullptr, rawDevice);
+    loadDeviceDispatch(device);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    VkFence rawFence;
+    if (vkCreateFence(device, &fenceInfo, hostAllocator(), &rawFence) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fence");
+    }
+
+    UniqueFence fence(device, rawFence);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = 0;
+
+    VkCommandPool rawPool;
+    if (vkCreateCommandPool(device, &poolInfo, hostAllocator(), &rawPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool!");
+    }
+
+    UniqueCommandPool commandPool(device, rawPool);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command buffers");
+    }
+
+    UniqueCommandBuffer ownedCommandBuffer(
+        CommandBufferParent{device, commandPool}, commandBuffer);
+
+    // Warm up both paths so that neither pays for first touches. The
+    // qualified names are the loader's exports.
+    recordBarriers(
+        commandBuffer, barriersPerCommandBuffer, ::vkCmdPipelineBarrier);
+    recordBarriers(
+        commandBuffer, barriersPerCommandBuffer, vkCmdPipelineBarrier);
+
+    const VkFence &rawHandle = fence.get();
+
+    double loaderStatus = nanosecondsPerCall(callCount, [&] {
+        for (uint64_t i = 0; i < callCount; i++) {
+            ::vkGetFenceStatus(device, rawHandle);
+        }
+    });
+
+    double directStatus = nanosecondsPerCall(callCount, [&] {
+        for (uint64_t i = 0; i < callCount; i++) {
+            vkGetFenceStatus(device, rawHandle);
+        }
+    });
+
+    double loaderBarrier = nanosecondsPerCall(callCount, [&] {
+        recordBarriers(commandBuffer, callCount, ::vkCmdPipelineBarrier);
+    });
+
+    double directBarrier = nanosecondsPerCall(callCount, [&] {
+        recordBarriers(commandBuffer, callCount, vkCmdPipelineBarrier);
+    });
+
+    stream << std::fixed << std::setprecision(2) << "Device dispatch, "
+           << callCount << " calls each, loader / direct:\n"
+           << "  vkGetFenceStatus      " << loaderStatus << " / "
+           << directStatus << " ns per call\n"
+           << "  vkCmdPipelineBarrier  " << loaderBarrier << " / "
+           << directBarrier << " ns per call" << std::defaultfloat
+           << std::endl;
+}
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "device_features.h"
+
+static vulkanctx::DeviceFeatures enabledFeatures;
+
+static auto hasDeviceExtension(const VkPhysicalDevice &physicalDevice,
+                               const char *name) -> bool {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(
+        physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(
+        physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    return std::any_of(extensions.begin(),
+                       extensions.end(),
+                       [name](const VkExtensionProperties &extension) {
+                           return strcmp(extension.extensionName, name) == 0;
+                       });
+}
+
+auto vulkanctx::allDeviceFeatures() -> DeviceFeatures {
+    DeviceFeatures features;
+    features.shaderDrawParameters = true;
+    features.timelineSemaphore = true;
+    features.bufferDeviceAddress = true;
+    features.descriptorIndexing = true;
+    features.synchronization2 = true;
+    features.dynamicRendering = true;
+    features.presentId = true;
+    features.presentWait = true;
+
+    return features;
+}
+
+auto vulkanctx::instanceApiVersion() -> uint32_t {
+    // Looked up rather than called, as 1.0 loaders don't export it
+    auto enumerateInstanceVersion =
+        reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+            vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+
+    uint32_t version = VK_API_VERSION_1_0;
+
+    if (enumerateInstanceVersion != nullptr) {
+        enumerateInstanceVersion(&version);
+    }
+
+    return std::min<uint32_t>(version, VK_API_VERSION_1_3);
+}
+
+// ---------------------------------------------------------------------------//
+//                               Feature chain                                //
+// ---------------------------------------------------------------------------//
+
+vulkanctx::DeviceFeatureChain::DeviceFeatureChain(
+    const VkPhysicalDevice &physicalDevice, const DeviceFeatures &requested) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    enabled_.apiVersion = std::min(properties.apiVersion, instanceApiVersion());
+
+    // Features can only be queried and chained from 1.1 on, a 1.0 device
+    // gets the plain VkPhysicalDeviceFeatures and none of the optional ones
+    if (enabled_.apiVersion < VK_API_VERSION_1_1) {
+        return;
+    }
+
+    useFeatures2_ = true;
+    useVulkan12_ = enabled_.apiVersion >= VK_API_VERSION_1_2;
+    useVulkan13_ = enabled_.apiVersion >= VK_API_VERSION_1_3;
+    useTimelineExtension_ =
+        !useVulkan12_ &&
+        hasDeviceExtension(physicalDevice,
+                           VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    useSynchronization2Extension_ =
+        !useVulkan13_ &&
+        hasDeviceExtension(physicalDevice,
+                           VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+
+    // Neither was promoted to core
+    usePresentIdExtension_ =
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME);
+    usePresentWaitExtension_ =
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+    link();
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features_);
+
+    const bool descriptorIndexing =
+        vulkan12_.descriptorIndexing && vulkan12_.runtimeDescriptorArray &&
+        vulkan12_.descriptorBindingPartiallyBound &&
+        vulkan12_.descriptorBindingSampledImageUpdateAfterBind &&
+        vulkan12_.descriptorBindingVariableDescriptorCount &&
+        vulkan12_.shaderSampledImageArrayNonUniformIndexing;
+
+    enabled_.shaderDrawParameters =
+        requested.shaderDrawParameters && vulkan11_.shaderDrawParameters;
+    enabled_.timelineSemaphore =
+        requested.timelineSemaphore &&
+        (vulkan12_.timelineSemaphore || timelineSemaphore_.timelineSemaphore);
+    enabled_.bufferDeviceAddress =
+        requested.bufferDeviceAddress && vulkan12_.bufferDeviceAddress;
+    enabled_.descriptorIndexing =
+        requested.descriptorIndexing && descriptorIndexing;
+    enabled_.synchronization2 = requested.synchronization2 &&
+                                (vulkan13_.synchronization2 ||
+                                 synchronization2_.synchronization2);
+    enabled_.dynamicRendering =
+        requested.dynamicRendering && vulkan13_.dynamicRendering;
+    enabled_.presentId = requested.presentId && presentId_.presentId;
+    enabled_.presentWait = requested.presentWait && enabled_.presentId &&
+                           presentWait_.presentWait;
+
+    // Extension structures may only be chained if the extension is enabled
+    useTimelineExtension_ = useTimelineExtension_ && enabled_.timelineSemaphore;
+    useSynchronization2Extension_ =
+        useSynchronization2Extension_ && enabled_.synchronization2;
+    usePresentIdExtension_ = usePresentIdExtension_ && enabled_.presentId;
+    usePresentWaitExtension_ =
+        usePresentWaitExtension_ && enabled_.presentWait;
+
+    // The query filled in everything the device supports, only the
+    // negotiated features are turned back on
+    features_ = {};
+    vulkan11_ = {};
+    vulkan12_ = {};
+    vulkan13_ = {};
+    timelineSemaphore_ = {};
+    synchronization2_ = {};
+    presentId_ = {};
+    presentWait_ = {};
+
+    vulkan11_.shaderDrawParameters = enabled_.shaderDrawParameters;
+
+    vulkan12_.timelineSemaphore = enabled_.timelineSemaphore;
+    timelineSemaphore_.timelineSemaphore = enabled_.timelineSemaphore;
+
+    vulkan12_.bufferDeviceAddress = enabled_.bufferDeviceAddress;
+
+    if (enabled_.descriptorIndexing) {
+        vulkan12_.descriptorIndexing = VK_TRUE;
+        vulkan12_.runtimeDescriptorArray = VK_TRUE;
+        vulkan12_.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12_.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12_.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        vulkan12_.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
+
+    vulkan13_.synchronization2 = enabled_.synchronization2;
+    synchronization2_.synchronization2 = enabled_.synchronization2;
+
+    vulkan13_.dynamicRendering = enabled_.dynamicRendering;
+
+    presentId_.presentId = enabled_.presentId;
+    presentWait_.presentWait = enabled_.presentWait;
+
+    link();
+}
+
+auto vulkanctx::DeviceFeatureChain::link() -> void {
+    void *next = nullptr;
+
+    auto prepend = [&next](auto &features, const VkStructureType &type) {
+        features.sType = type;
+        features.pNext = next;
+        next = &features;
+    };
+
+    if (usePresentWaitExtension_) {
+        prepend(presentWait_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR);
+    }
+
+    if (usePresentIdExtension_) {
+        prepend(presentId_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR);
+    }
+
+    if (useSynchronization2Extension_) {
+        prepend(synchronization2_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES);
+    }
+
+    if (useTimelineExtension_) {
+        prepend(timelineSemaphore_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES);
+    }
+
+    if (useVulkan13_) {
+        prepend(vulkan13_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES);
+    }
+
+    // VkPhysicalDeviceVulkan11Features itself only exists from 1.2 on
+    if (useVulkan12_) {
+        prepend(vulkan12_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+        prepend(vulkan11_,
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES);
+    }
+
+    prepend(features_, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2);
+}
+
+auto vulkanctx::DeviceFeatureChain::attach(
+    VkDeviceCreateInfo &createInfo, std::vector<const char *> &extensions)
+    -> void {
+    if (useTimelineExtension_) {
+        extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+
+    if (useSynchronization2Extension_) {
+        extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+    }
+
+    if (usePresentIdExtension_) {
+        extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+    }
+
+    if (usePresentWaitExtension_) {
+        extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
+    if (!useFeatures2_) {
+        createInfo.pEnabledFeatures = &features_.features;
+        return;
+    }
+
+    auto *last = reinterpret_cast<VkBaseOutStructure *>(&features_);
+    while (last->pNext != nullptr) {
+        last = last->pNext;
+    }
+
+    last->pNext = static_cast<VkBaseOutStructure *>(
+        const_cast<void *>(createInfo.pNext));
+    createInfo.pNext = &features_;
+    createInfo.pEnabledFeatures = nullptr;
+}
+
+auto vulkanctx::DeviceFeatureChain::enabled() const -> const DeviceFeatures & {
+    return enabled_;
+}
+
+auto vulkanctx::queryDeviceFeatures(const VkPhysicalDevice &physicalDevice)
+    -> DeviceFeatures {
+    return DeviceFeatureChain(physicalDevice, allDeviceFeatures()).enabled();
+}
+
+// ---------------------------------------------------------------------------//
+//                              Enabled features                              //
+// ---------------------------------------------------------------------------//
+
+auto vulkanctx::enabledDeviceFeatures() -> const DeviceFeatures & {
+    return enabledFeatures;
+}
+
+auto vulkanctx::setEnabledDeviceFeatures(const DeviceFeatures &features)
+    -> void {
+    enabledFeatures = features;
+}
+
+auto vulkanctx::reportDeviceFeatures(std::ostream &stream) -> void {
+    const DeviceFeatures &features = enabledDeviceFeatures();
+
+    stream << "Device features: Vulkan "
+           << VK_API_VERSION_MAJOR(features.apiVersion) << "."
+           << VK_API_VERSION_MINOR(features.apiVersion);
+
+    const std::pair<bool, const char *> names[] = {
+        {features.timelineSemaphore, "timeline semaphores"},
+        {features.synchronization2, "synchronization2"},
+        {features.dynamicRendering, "dynamic rendering"},
+        {features.descriptorIndexing, "descriptor indexing"},
+        {features.bufferDeviceAddress, "buffer device address"},
+        {features.shaderDrawParameters, "shader draw parameters"},
+        {features.presentId, "present id"},
+        {features.presentWait, "present wait"},
+    };
+
+    for (const auto &[enabled, name] : names) {
+        if (enabled) {
+            stream << ", " << name;
+        }
+    }
+
+    stream << std::endl;
+}
@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#include "diagnostics.h"
+
+// Default profile of builds which don't pass DIAGNOSTICS to make
+#ifndef VULKANCTX_DIAGNOSTICS
+#define VULKANCTX_DIAGNOSTICS "validation"
+#endif
+
+auto vulkanctx::DiagnosticsConfig::profileName() const -> std::string {
+    if (!diagnosticsCompiledIn) {
+        return "release (diagnostics compiled out)";
+    }
+
+    if (!validation) {
+        return "off";
+    }
+
+    if (gpuAssisted && bestPractices && synchronization) {
+        return "full";
+    }
+
+    std::string name = "validation";
+
+    if (gpuAssisted) {
+        name += ", gpu-assisted";
+    }
+
+    if (bestPractices) {
+        name += ", best-practices";
+    }
+
+    if (synchronization) {
+        name += ", synchronization";
+    }
+
+    return name;
+}
+
+auto vulkanctx::parseDiagnostics(const std::string &description)
+    -> DiagnosticsConfig {
+    DiagnosticsConfig config;
+
+    std::istringstream stream(description);
+    std::string toggle;
+
+    while (std::getline(stream, toggle, ',')) {
+        // Allow both "a,b" and "a, b"
+        toggle.erase(0, toggle.find_first_not_of(' '));
+        toggle.erase(toggle.find_last_not_of(' ') + 1);
+
+        if (toggle.empty() || toggle == "off") {
+            continue;
+        } else if (toggle == "validation") {
+            config.validation = true;
+        } else if (toggle == "gpu-assisted") {
+            config.gpuAssisted = true;
+        } else if (toggle == "best-practices") {
+            config.bestPractices = true;
+        } else if (toggle == "synchronization") {
+            config.synchronization = true;
+        } else if (toggle == "full") {
+            config.gpuAssisted = true;
+            config.bestPractices = true;
+            config.synchronization = true;
+        } else {
+            throw std::runtime_error("Unknown diagnostics toggle '" + toggle +
+                                     "'");
+        }
+    }
+
+    // The extra checks are features of the validation layer
+    config.validation = config.validation || config.gpuAssisted ||
+                        config.bestPractices || config.synchronization;
+
+    return config;
+}
+
+auto vulkanctx::diagnosticsConfig() -> const DiagnosticsConfig & {
+    static const DiagnosticsConfig config = [] {
+        if (!diagnosticsCompiledIn) {
+            return DiagnosticsConfig{};
+        }
+
+        const char *environment = std::getenv("VULKANCTX_DIAGNOSTICS");
+
+        return parseDiagnostics(environment != nullptr ? environment
+                                                       : VULKANCTX_DIAGNOSTICS);
+    }();
+
+    return config;
+}
+
+auto vulkanctx::reportDiagnostics(std::ostream &stream) -> void {
+    stream << "Diagnostics profile: " << diagnosticsConfig().profileName()
+           << std::endl;
+}
@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+#include "device_dispatch.h"
+#include "frame_depth.h"
+#include "host_allocator.h"
+#include "vulkan_context.h"
+
+// Frames averaged for every decision, and how many decisions in a row have
+// to agree before the depth changes
+static constexpr uint32_t framesPerDecision = 30;
+static constexpr uint32_t decisionsToChange = 3;
+
+// Share of the longer side below which the shorter one is cheap enough to
+// run serially
+static constexpr double serialShare = 0.1;
+
+static auto recordTimestamp(const VkCommandBuffer &commandBuffer,
+                            const VkQueryPool &queryPool,
+                            const uint32_t &query,
+                            const bool &reset) -> void {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    if (vulkanctx::vkBeginCommandBuffer(commandBuffer, &beginInfo) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffers.");
+    }
+
+    // Both queries of the slot are reset by the first one
+    if (reset) {
+        vulkanctx::vkCmdResetQueryPool(commandBuffer, queryPool, query, 2);
+    }
+
+    // The frame's submission waits for its swap chain images at the color
+    // attachment output stage. A timestamp at the top of the pipe wouldn't
+    // be held back by that, and under FIFO would count the wait for the
+    // display as GPU time.
+    vulkanctx::vkCmdWriteTimestamp(
+        commandBuffer,
+        reset ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+              : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        queryPool,
+        query);
+
+    if (vulkanctx::vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+vulkanctx::FrameDepthController::FrameDepthController(
+    const VkDevice &device,
+    const VkPhysicalDevice &physicalDevice,
+    const VkSurfaceKHR &surface,
+    const uint32_t &maxDepth)
+    : device_(device), maxDepth_(std::max(maxDepth, 1u)),
+      depth_(std::min(maxDepth_, 2u)), slots_(maxDepth_) {
+    const uint32_t queueFamily = graphicsQueueFamily(physicalDevice, surface);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    timestamps_ = queueFamilies[queueFamily].timestampValidBits > 0;
+    timestampPeriod_ = properties.limits.timestampPeriod;
+
+    if (!timestamps_) {
+        return;
+    }
+
+    commandPool_ = createCommandPool(device_, physicalDevice, surface);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = maxDepth_ * 2;
+
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(
+            device_, &queryPoolInfo, hostAllocator(), &queryPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timestamp query pool");
+    }
+
+    queryPool_ = UniqueQueryPool(device_, queryPool);
+
+    // The slot's fence guards every reuse, so each pair is recorded once
+    for (uint32_t i = 0; i < maxDepth_; i++) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool_;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 2;
+
+        VkCommandBuffer commandBuffers[2];
+        if (vkAllocateCommandBuffers(device_, &allocInfo, commandBuffers) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create command buffers");
+        }
+
+        const CommandBufferParent parent{device_, commandPool_};
+        slots_[i].begin = UniqueCommandBuffer(parent, commandBuffers[0]);
+        slots_[i].end = UniqueCommandBuffer(parent, commandBuffers[1]);
+
+        recordTimestamp(slots_[i].begin, queryPool_, i * 2, true);
+        recordTimestamp(slots_[i].end, queryPool_, i * 2 + 1, false);
+    }
+}
+
+auto vulkanctx::FrameDepthController::begin(const uint32_t &slot) const
+    -> VkCommandBuffer {
+    return slots_[slot].begin.get();
+}
+
+auto vulkanctx::FrameDepthController::end(const uint32_t &slot) const
+    -> VkCommandBuffer {
+    return slots_[slot].end.get();
+}
+
+auto vulkanctx::FrameDepthController::submitted(
+    const uint32_t &slot, const FramePacing::Clock::duration &cpuTime)
+    -> void {
+    slots_[slot].cpuTime = cpuTime;
+    slots_[slot].pending = true;
+}
+
+auto vulkanctx::FrameDepthController::collect(const uint32_t &slot) -> void {
+    Slot &current = slots_[slot];
+
+    if (!current.pending) {
+        return;
+    }
+
+    current.pending = false;
+
+    if (!timestamps_) {
+        decide(0.0, 0.0);
+        return;
+    }
+
+    uint64_t ticks[2];
+
+    if (vkGetQueryPoolResults(device_,
+                              queryPool_,
+                              slot * 2,
+                              2,
+                              sizeof(ticks),
+                              ticks,
+                              sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+
+    decide(std::chrono::duration<double, std::nano>(current.cpuTime).count(),
+           ticks[1] > ticks[0] ? (ticks[1] - ticks[0]) * timestampPeriod_
+                               : 0.0);
+}
+
+auto vulkanctx::FrameDepthController::decide(const double &cpuNanoseconds,
+                                             const double &gpuNanoseconds)
+    -> void {
+    samples_++;
+    cpuNanoseconds_ += cpuNanoseconds;
+    gpuNanoseconds_ += gpuNanoseconds;
+
+    if (samples_ < framesPerDecision) {
+        return;
+    }
+
+    const double cpu = cpuNanoseconds_ / samples_;
+    const double gpu = gpuNanoseconds_ / samples_;
+
+    if (timestamps_) {
+        framesMeasured_ += samples_;
+        totalCpuNanoseconds_ += cpuNanoseconds_;
+        totalGpuNanoseconds_ += gpuNanoseconds_;
+    }
+
+    samples_ = 0;
+    cpuNanoseconds_ = 0.0;
+    gpuNanoseconds_ = 0.0;
+
+    uint32_t candidate = depth_;
+
+    if (latencySensitive_) {
+        candidate = 1;
+    } else if (!timestamps_) {
+        return;
+    } else if (std::min(cpu, gpu) <= serialShare * std::max(cpu, gpu)) {
+        candidate = 1;
+    } else if (cpu > gpu) {
+        candidate = maxDepth_;
+    } else {
+        candidate = std::min(maxDepth_, 2u);
+    }
+
+    if (candidate != candidate_) {
+        candidate_ = candidate;
+        candidateCount_ = 0;
+    }
+
+    if (++candidateCount_ >= decisionsToChange && candidate != depth_) {
+        depth_ = candidate;
+        depthChanges_++;
+    }
+}
+
+auto vulkanctx::FrameDepthController::setLatencySensitive(
+    const bool &latencySensitive) -> void {
+    latencySensitive_ = latencySensitive;
+}
+
+auto vulkanctx::FrameDepthController::depth() const -> uint32_t {
+    return depth_;
+}
+
+auto vulkanctx::FrameDepthController::maxDepth() const -> uint32_t {
+    return maxDepth_;
+}
+
+auto vulkanctx::FrameDepthController::report(std::ostream &stream) const
+    -> void {
+    stream << "Frames in flight: " << depth_ << " of up to " << maxDepth_
+           << ", changed " << depthChanges_ << " times";
+
+    if (framesMeasured_ > 0) {
+        const double frames = static_cast<double>(framesMeasured_);
+
+        stream << std::fixed << std::setprecision(3) << ", cpu "
+               << totalCpuNanoseconds_ / frames / 1e6 << " ms, gpu "
+               << totalGpuNanoseconds_ / frames / 1e6 << " ms per frame";
+    } else if (!timestamps_) {
+        stream << ", no timestamps";
+    }
+
+    stream << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,987 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "device_dispatch.h"
+#include "device_features.h"
+#include "frame_export.h"
+#include "host_allocator.h"
+#include "vulkan_context.h"
+#include "vulkan_handle.h"
+
+// Upper bound of the ring, which also bounds the descriptors of a message
+static constexpr uint32_t maxExportImages = 8;
+
+// Both ends are the same binary on the same machine, so the messages go over
+// the socket as they are
+struct ExportHandshake {
+    uint8_t deviceUUID[VK_UUID_SIZE];
+    uint8_t driverUUID[VK_UUID_SIZE];
+    uint32_t imageCount;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t memoryTypeIndex;
+    uint32_t syncFd;
+    uint64_t allocationSize;
+    uint64_t offset;
+    uint64_t rowPitch;
+};
+
+struct ExportFrame {
+    uint64_t frame;
+    uint32_t slot;
+    uint32_t hasSyncFd;
+};
+
+struct ExportRelease {
+    uint32_t slot;
+};
+
+using ExportClock = std::chrono::steady_clock;
+
+// ---------------------------------------------------------------------------//
+//                                  Sockets                                   //
+// ---------------------------------------------------------------------------//
+
+namespace {
+
+class FileDescriptor {
+  public:
+    explicit FileDescriptor(int fd = -1) : fd_(fd) {}
+    ~FileDescriptor() { reset(); }
+
+    FileDescriptor(const FileDescriptor &) = delete;
+    auto operator=(const FileDescriptor &) -> FileDescriptor & = delete;
+
+    FileDescriptor(FileDescriptor &&other) noexcept : fd_(other.release()) {}
+
+    auto operator=(FileDescriptor &&other) noexcept -> FileDescriptor & {
+        if (this != &other) {
+            reset();
+            fd_ = other.release();
+        }
+
+        return *this;
+    }
+
+    auto get() const -> int { return fd_; }
+
+    auto release() -> int {
+        int fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+    auto reset() -> void {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+  private:
+    int fd_;
+};
+
+} // namespace
+
+static auto systemError(const std::string &what) -> std::runtime_error {
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+// Returns false if the other end is gone
+static auto sendMessage(int socket,
+                        const void *data,
+                        size_t size,
+                        const std::vector<int> &fds = {}) -> bool {
+    iovec iov{const_cast<void *>(data), size};
+
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxExportImages)];
+
+    if (!fds.empty()) {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+    }
+
+    if (sendmsg(socket, &message, MSG_NOSIGNAL) < 0) {
+        if (errno == EPIPE || errno == ECONNRESET) {
+            return false;
+        }
+
+        throw systemError("Failed to send export message");
+    }
+
+    return true;
+}
+
+// Returns the result of recvmsg: 0 once the other end has hung up, and -1 if
+// MSG_DONTWAIT was given and nothing is pending. Received descriptors are
+// appended to fds and owned by the caller.
+static auto receiveMessage(int socket,
+                           void *data,
+                           size_t size,
+                           std::vector<int> &fds,
+                           int flags = 0) -> ssize_t {
+    iovec iov{data, size};
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxExportImages)];
+
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t received = recvmsg(socket, &message, flags | MSG_CMSG_CLOEXEC);
+
+    if (received < 0) {
+        if ((flags & MSG_DONTWAIT) &&
+            (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return -1;
+        }
+
+        throw systemError("Failed to receive export message");
+    }
+
+    for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET ||
+            header->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const auto *passed = reinterpret_cast<const int *>(CMSG_DATA(header));
+        fds.insert(fds.end(), passed, passed + count);
+    }
+
+    if (received > 0 && static_cast<size_t>(received) != size) {
+        throw std::runtime_error("Malformed export message");
+    }
+
+    return received;
+}
+
+static auto socketAddress(const std::string &path) -> sockaddr_un {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Export socket path is too long");
+    }
+
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    return address;
+}
+
+auto vulkanctx::acceptExportConsumer(const std::string &path) -> int {
+    FileDescriptor listener(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+
+    if (listener.get() < 0) {
+        throw systemError("Failed to create export socket");
+    }
+
+    sockaddr_un address = socketAddress(path);
+
+    // Left over from a previous run that didn't get to clean up
+    unlink(path.c_str());
+
+    if (bind(listener.get(),
+             reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0 ||
+        listen(listener.get(), 1) != 0) {
+        throw systemError("Failed to listen on " + path);
+    }
+
+    std::cout << "Waiting for an export consumer on " << path << std::endl;
+
+    int connection = accept4(listener.get(), nullptr, nullptr, SOCK_CLOEXEC);
+    unlink(path.c_str());
+
+    if (connection < 0) {
+        throw systemError("Failed to accept export consumer");
+    }
+
+    return connection;
+}
+
+auto vulkanctx::connectExportProducer(const std::string &path) -> int {
+    FileDescriptor connection(
+        socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+
+    if (connection.get() < 0) {
+        throw systemError("Failed to create export socket");
+    }
+
+    sockaddr_un address = socketAddress(path);
+
+    if (connect(connection.get(),
+                reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0) {
+        throw systemError("Failed to connect to " + path);
+    }
+
+    return connection.release();
+}
+
+// ---------------------------------------------------------------------------//
+//                              Headless device                               //
+// ---------------------------------------------------------------------------//
+
+struct HeadlessDevice {
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    bool syncFd = false;
+};
+
+static auto hasDeviceExtension(const VkPhysicalDevice &physicalDevice,
+                               const char *name) -> bool {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(
+        physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(
+        physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    for (const auto &extension : extensions) {
+        if (strcmp(extension.extensionName, name) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static auto deviceIdentity(const VkPhysicalDevice &physicalDevice)
+    -> VkPhysicalDeviceIDProperties {
+    VkPhysicalDeviceIDProperties identity{};
+    identity.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &identity;
+
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    return identity;
+}
+
+// Sync files are optional, without them the producer waits for the frame
+// itself before announcing it
+static auto canExportSyncFd(const VkPhysicalDevice &physicalDevice) -> bool {
+    if (!hasDeviceExtension(physicalDevice,
+                            VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME)) {
+        return false;
+    }
+
+    VkPhysicalDeviceExternalSemaphoreInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_SEMAPHORE_INFO;
+    info.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT;
+
+    VkExternalSemaphoreProperties properties{};
+    properties.sType = VK_STRUCTURE_TYPE_EXTERNAL_SEMAPHORE_PROPERTIES;
+
+    vkGetPhysicalDeviceExternalSemaphoreProperties(
+        physicalDevice, &info, &properties);
+
+    return properties.externalSemaphoreFeatures &
+           VK_EXTERNAL_SEMAPHORE_FEATURE_EXPORTABLE_BIT;
+}
+
+static auto graphicsQueueFamily(const VkPhysicalDevice &physicalDevice)
+    -> std::optional<uint32_t> {
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    for (uint32_t i = 0; i < queueFamilyCount; i++) {
+        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+// Picks the producer's device, or with an identity given, the device the
+// consumer has to import into
+static auto pickHeadlessDevice(const VkInstance &instance,
+                               const ExportHandshake *identity = nullptr)
+    -> HeadlessDevice {
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+    for (const auto &device : devices) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+
+        auto queueFamily = graphicsQueueFamily(device);
+
+        if (properties.apiVersion < VK_API_VERSION_1_1 ||
+            !queueFamily.has_value() ||
+            !hasDeviceExtension(device,
+                                VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME)) {
+            continue;
+        }
+
+        if (identity != nullptr) {
+            auto deviceId = deviceIdentity(device);
+
+            if (memcmp(deviceId.deviceUUID,
+                       identity->deviceUUID,
+                       VK_UUID_SIZE) != 0 ||
+                memcmp(deviceId.driverUUID,
+                       identity->driverUUID,
+                       VK_UUID_SIZE) != 0) {
+                continue;
+            }
+        }
+
+        return HeadlessDevice{
+            device, queueFamily.value(), canExportSyncFd(device)};
+    }
+
+    throw std::runtime_error("Failed to find a GPU that can share memory");
+}
+
+static auto createHeadlessDevice(const HeadlessDevice &headless,
+                                 const std::vector<const char *> &extensions)
+    -> vulkanctx::UniqueDevice {
+    float queuePriority = 1.0f;
+
+    VkDeviceQueueCreateInfo queueCreateInfo{};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = headless.queueFamily;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+
+    std::vector<const char *> enabledExtensions = extensions;
+
+    // Nothing is presented without a swap chain
+    vulkanctx::DeviceFeatures requested = vulkanctx::allDeviceFeatures();
+    requested.presentId = false;
+    requested.presentWait = false;
+
+    vulkanctx::DeviceFeatureChain features(headless.physicalDevice, requested);
+
+    VkDeviceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.queueCreateInfoCount = 1;
+    createInfo.pQueueCreateInfos = &queueCreateInfo;
+    features.attach(createInfo, enabledExtensions);
+    createInfo.enabledExtensionCount =
+        static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
+    VkDevice device;
+    if (vkCreateDevice(headless.physicalDevice,
+                       &createInfo,
+                       vulkanctx::hostAllocator(),
+                       &device) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create logical device");
+    }
+
+    vulkanctx::loadDeviceDispatch(device);
+    vulkanctx::setEnabledDeviceFeatures(features.enabled());
+
+    return vulkanctx::UniqueDevice(nullptr, device);
+}
+
+// ---------------------------------------------------------------------------//
+//                                  Producer                                  //
+// ---------------------------------------------------------------------------//
+
+auto vulkanctx::runExportProducer(const char *applicationName,
+                                  int socket,
+                                  const ExportOptions &options)
+    -> ExportStatistics {
+    FileDescriptor connection(socket);
+
+    if (options.imageCount == 0 || options.imageCount > maxExportImages) {
+        throw std::runtime_error("Unsupported number of export images");
+    }
+
+    UniqueInstance instance = createInstance(applicationName, true);
+    UniqueDebugMessenger debugMessenger = setupDebugMessenger(instance);
+
+    HeadlessDevice headless = pickHeadlessDevice(instance);
+
+    std::vector<const char *> extensions = {
+        VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME};
+
+    if (headless.syncFd) {
+        extensions.push_back(VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME);
+    }
+
+    UniqueDevice device = createHeadlessDevice(headless, extensions);
+
+    VkQueue queue;
+    vkGetDeviceQueue(device, headless.queueFamily, 0, &queue);
+
+    if (vkGetMemoryFdKHR == nullptr ||
+        (headless.syncFd && vkGetSemaphoreFdKHR == nullptr)) {
+        throw std::runtime_error("Failed to load external memory functions");
+    }
+
+    // The same format the windowed path renders to
+    const VkFormat format = VK_FORMAT_B8G8R8A8_SRGB;
+    const VkExtent2D extent = {options.width, options.height};
+
+    // Linear, so that the consumer can read the pixels straight from memory
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(
+        headless.physicalDevice, format, &formatProperties);
+
+    if (!(formatProperties.linearTilingFeatures &
+          VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+        throw std::runtime_error("Linear images can't be rendered to");
+    }
+
+    ExportHandshake handshake{};
+    auto identity = deviceIdentity(headless.physicalDevice);
+    memcpy(handshake.deviceUUID, identity.deviceUUID, VK_UUID_SIZE);
+    memcpy(handshake.driverUUID, identity.driverUUID, VK_UUID_SIZE);
+    handshake.imageCount = options.imageCount;
+    handshake.width = extent.width;
+    handshake.height = extent.height;
+    handshake.format = format;
+    handshake.syncFd = headless.syncFd;
+
+    std::vector<UniqueImage> images;
+    std::vector<UniqueDeviceMemory> memories;
+    std::vector<VkImage> rawImages;
+
+    for (uint32_t i = 0; i < options.imageCount; i++) {
+        VkExternalMemoryImageCreateInfo externalInfo{};
+        externalInfo.sType =
+            VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO;
+        externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.pNext = &externalInfo;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_LINEAR;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image;
+        if (vkCreateImage(device, &imageInfo, hostAllocator(), &image) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create export image");
+        }
+
+        images.push_back(UniqueImage(device, image));
+        rawImages.push_back(image);
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, image, &requirements);
+
+        // The consumer maps the memory, so it has to be host visible, and
+        // cached where possible since the consumer only reads
+        auto memoryType =
+            findMemoryType(headless.physicalDevice,
+                           requirements.memoryTypeBits,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                               VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+
+        if (!memoryType.has_value()) {
+            memoryType = findMemoryType(headless.physicalDevice,
+                                        requirements.memoryTypeBits,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        }
+
+        if (!memoryType.has_value()) {
+            throw std::runtime_error("Export images can't be host visible");
+        }
+
+        VkExportMemoryAllocateInfo exportInfo{};
+        exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO;
+        exportInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = &exportInfo;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType.value();
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, hostAllocator(), &memory) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate export memory");
+        }
+
+        memories.push_back(UniqueDeviceMemory(device, memory));
+        vkBindImageMemory(device, image, memory, 0);
+
+        handshake.memoryTypeIndex = memoryType.value();
+        handshake.allocationSize = requirements.size;
+    }
+
+    // Every image has the same layout
+    VkImageSubresource subresource{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0};
+    VkSubresourceLayout layout;
+    vkGetImageSubresourceLayout(device, rawImages[0], &subresource, &layout);
+
+    handshake.offset = layout.offset;
+    handshake.rowPitch = layout.rowPitch;
+
+    auto imageViews = createImageViews(device, rawImages, format);
+
+    // Stays in the general layout, the only one the host may read from
+    auto renderPass =
+        createRenderPass(device, format, VK_IMAGE_LAYOUT_GENERAL);
+    auto graphicsPipeline = createGraphicsPipeline(device, renderPass, extent);
+    auto framebuffers =
+        createFramebuffers(device, renderPass, imageViews, extent);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = headless.queueFamily;
+
+    VkCommandPool rawCommandPool;
+    if (vkCreateCommandPool(
+            device, &poolInfo, hostAllocator(), &rawCommandPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command pool!");
+    }
+
+    UniqueCommandPool commandPool(device, rawCommandPool);
+
+    auto commandBuffers = createCommandBuffers(device,
+                                               extent,
+                                               renderPass,
+                                               graphicsPipeline.handle,
+                                               commandPool,
+                                               framebuffers);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    std::vector<UniqueFence> fences;
+
+    for (uint32_t i = 0; i < options.imageCount; i++) {
+        VkFence fence;
+        if (vkCreateFence(device, &fenceInfo, hostAllocator(), &fence) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create fence");
+        }
+
+        fences.push_back(UniqueFence(device, fence));
+    }
+
+    // A sync file export resets the semaphore, so a single one serves every
+    // frame as long as it is exported right after each submission
+    UniqueSemaphore renderFinished;
+
+    if (headless.syncFd) {
+        VkExportSemaphoreCreateInfo exportInfo{};
+        exportInfo.sType = VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO;
+        exportInfo.handleTypes = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &exportInfo;
+
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(
+                device, &semaphoreInfo, hostAllocator(), &semaphore) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create semaphore");
+        }
+
+        renderFinished = UniqueSemaphore(device, semaphore);
+    }
+
+    std::vector<FileDescriptor> memoryFds;
+    std::vector<int> rawMemoryFds;
+
+    for (const auto &memory : memories) {
+        VkMemoryGetFdInfoKHR getFdInfo{};
+        getFdInfo.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
+        getFdInfo.memory = memory;
+        getFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
+        int fd;
+        if (vkGetMemoryFdKHR(device, &getFdInfo, &fd) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to export image memory");
+        }
+
+        memoryFds.emplace_back(fd);
+        rawMemoryFds.push_back(fd);
+    }
+
+    if (!sendMessage(
+            connection.get(), &handshake, sizeof(handshake), rawMemoryFds)) {
+        throw std::runtime_error("Export consumer hung up");
+    }
+
+    // The consumer holds its own references now
+    memoryFds.clear();
+
+    ExportStatistics statistics;
+    statistics.syncFd = headless.syncFd;
+
+    std::vector<bool> held(options.imageCount, false);
+    bool connected = true;
+    auto start = ExportClock::now();
+
+    for (uint64_t frame = 1; connected && frame <= options.frameCount;
+         frame++) {
+        const uint32_t slot = (frame - 1) % options.imageCount;
+
+        // Take back whatever the consumer is done with, and only block if it
+        // still holds the image this frame renders into
+        while (true) {
+            ExportRelease release;
+            std::vector<int> unexpectedFds;
+
+            ssize_t received = receiveMessage(connection.get(),
+                                              &release,
+                                              sizeof(release),
+                                              unexpectedFds,
+                                              held[slot] ? 0 : MSG_DONTWAIT);
+
+            for (int fd : unexpectedFds) {
+                close(fd);
+            }
+
+            if (received == 0) {
+                connected = false;
+                break;
+            } else if (received < 0) {
+                break;
+            }
+
+            if (release.slot < options.imageCount) {
+                held[release.slot] = false;
+            }
+        }
+
+        if (!connected) {
+            break;
+        }
+
+        const VkFence &fence = fences[slot].get();
+        vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(device, 1, &fence);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffers[slot].get();
+
+        if (headless.syncFd) {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &renderFinished.get();
+        }
+
+        if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit export frame");
+        }
+
+        ExportFrame message{frame, slot, handshake.syncFd};
+        std::vector<int> messageFds;
+        FileDescriptor syncFd;
+
+        if (headless.syncFd) {
+            VkSemaphoreGetFdInfoKHR getFdInfo{};
+            getFdInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR;
+            getFdInfo.semaphore = renderFinished;
+            getFdInfo.handleType =
+                VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_SYNC_FD_BIT;
+
+            int fd;
+            if (vkGetSemaphoreFdKHR(device, &getFdInfo, &fd) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to export sync file");
+            }
+
+            syncFd = FileDescriptor(fd);
+            messageFds.push_back(fd);
+        } else {
+            vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+        }
+
+        if (!sendMessage(
+                connection.get(), &message, sizeof(message), messageFds)) {
+            break;
+        }
+
+        held[slot] = true;
+        statistics.frames++;
+        statistics.bytes += uint64_t{extent.width} * extent.height * 4;
+    }
+
+    statistics.seconds =
+        std::chrono::duration<double>(ExportClock::now() - start).count();
+
+    vkDeviceWaitIdle(device);
+
+    return statistics;
+}
+
+// ---------------------------------------------------------------------------//
+//                                  Consumer                                  //
+// ---------------------------------------------------------------------------//
+
+auto vulkanctx::runExportConsumer(const char *applicationName, int socket)
+    -> ExportStatistics {
+    FileDescriptor connection(socket);
+
+    ExportHandshake handshake;
+    std::vector<int> rawMemoryFds;
+
+    ssize_t received = receiveMessage(
+        connection.get(), &handshake, sizeof(handshake), rawMemoryFds);
+
+    std::vector<FileDescriptor> memoryFds;
+    for (int fd : rawMemoryFds) {
+        memoryFds.emplace_back(fd);
+    }
+
+    if (received == 0) {
+        throw std::runtime_error("Export producer hung up");
+    }
+
+    if (memoryFds.size() != handshake.imageCount) {
+        throw std::runtime_error("Export producer sent no image memory");
+    }
+
+    UniqueInstance instance = createInstance(applicationName, true);
+    UniqueDebugMessenger debugMessenger = setupDebugMessenger(instance);
+
+    // Opaque handles only import into the same device and driver
+    HeadlessDevice headless = pickHeadlessDevice(instance, &handshake);
+    UniqueDevice device = createHeadlessDevice(
+        headless, {VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME});
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(headless.physicalDevice,
+                                        &memoryProperties);
+
+    const VkMemoryPropertyFlags memoryFlags =
+        memoryProperties.memoryTypes[handshake.memoryTypeIndex].propertyFlags;
+    const bool coherent = memoryFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    std::vector<UniqueDeviceMemory> memories;
+    std::vector<const uint8_t *> pixels;
+
+    for (auto &fd : memoryFds) {
+        VkImportMemoryFdInfoKHR importInfo{};
+        importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR;
+        importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+        importInfo.fd = fd.get();
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = &importInfo;
+        allocInfo.allocationSize = handshake.allocationSize;
+        allocInfo.memoryTypeIndex = handshake.memoryTypeIndex;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, hostAllocator(), &memory) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to import image memory");
+        }
+
+        // A successful import takes ownership of the descriptor
+        fd.release();
+        memories.push_back(UniqueDeviceMemory(device, memory));
+
+        void *mapped;
+        if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to map image memory");
+        }
+
+        pixels.push_back(static_cast<const uint8_t *>(mapped) +
+                         handshake.offset);
+    }
+
+    ExportStatistics statistics;
+    statistics.syncFd = handshake.syncFd;
+
+    const size_t rowBytes = size_t{handshake.width} * 4;
+    uint64_t checksum = 0;
+    auto start = ExportClock::now();
+
+    while (true) {
+        ExportFrame frame;
+        std::vector<int> fds;
+
+        if (receiveMessage(connection.get(), &frame, sizeof(frame), fds) ==
+            0) {
+            break;
+        }
+
+        std::vector<FileDescriptor> frameFds;
+        for (int fd : fds) {
+            frameFds.emplace_back(fd);
+        }
+
+        if (frame.slot >= pixels.size() ||
+            (frame.hasSyncFd && frameFds.empty())) {
+            throw std::runtime_error("Malformed export frame");
+        }
+
+        // A sync file becomes readable once the GPU work behind it is done
+        if (frame.hasSyncFd) {
+            pollfd descriptor{frameFds[0].get(), POLLIN, 0};
+
+            while (poll(&descriptor, 1, -1) < 0) {
+                if (errno != EINTR) {
+                    throw systemError("Failed to wait for export frame");
+                }
+            }
+        }
+
+        if (!coherent) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = memories[frame.slot];
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+
+            vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+
+        // Stands in for an encoder by touching every pixel once
+        for (uint32_t y = 0; y < handshake.height; y++) {
+            const uint8_t *row = pixels[frame.slot] + y * handshake.rowPitch;
+
+            for (size_t x = 0; x + sizeof(uint64_t) <= rowBytes;
+                 x += sizeof(uint64_t)) {
+                uint64_t word;
+                memcpy(&word, row + x, sizeof(word));
+                checksum ^= word;
+            }
+        }
+
+        statistics.frames++;
+        statistics.bytes += rowBytes * handshake.height;
+
+        ExportRelease release{frame.slot};
+        if (!sendMessage(connection.get(), &release, sizeof(release))) {
+            break;
+        }
+    }
+
+    statistics.seconds =
+        std::chrono::duration<double>(ExportClock::now() - start).count();
+
+    // Keeps the reads from being optimized out and lets runs be compared
+    std::cout << "Export consumer checksum: " << std::hex << checksum
+              << std::dec << std::endl;
+
+    return statistics;
+}
+
+// ---------------------------------------------------------------------------//
+//                                 Benchmark                                  //
+// ---------------------------------------------------------------------------//
+
+auto vulkanctx::runExportBenchmark(const char *applicationName,
+                                   const ExportOptions &options,
+                                   std::ostream &stream) -> void {
+    int sockets[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0) {
+        throw systemError("Failed to create export socket pair");
+    }
+
+    pid_t child = fork();
+
+    if (child < 0) {
+        close(sockets[0]);
+        close(sockets[1]);
+        throw systemError("Failed to start export consumer");
+    }
+
+    if (child == 0) {
+        close(sockets[0]);
+
+        int status = EXIT_SUCCESS;
+
+        try {
+            auto statistics = runExportConsumer(applicationName, sockets[1]);
+            reportExport(stream, "consumer", statistics);
+        } catch (const std::exception &e) {
+            std::cerr << "Export consumer: " << e.what() << std::endl;
+            status = EXIT_FAILURE;
+        }
+
+        stream.flush();
+        _exit(status);
+    }
+
+    close(sockets[1]);
+
+    ExportStatistics statistics;
+
+    try {
+        statistics = runExportProducer(applicationName, sockets[0], options);
+    } catch (...) {
+        waitpid(child, nullptr, 0);
+        throw;
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    reportExport(stream, "producer", statistics);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        throw std::runtime_error("Export consumer failed");
+    }
+}
+
+auto vulkanctx::reportExport(std::ostream &stream,
+                             const char *role,
+                             const ExportStatistics &statistics) -> void {
+    double seconds = statistics.seconds > 0.0 ? statistics.seconds : 1e-9;
+
+    stream << std::fixed << std::setprecision(1) << "Export " << role << ": "
+           << statistics.frames << " frames in " << statistics.seconds
+           << " s, " << statistics.frames / seconds << " fps, "
+           << statistics.bytes / (1024.0 * 1024.0) / seconds << " MiB/s"
+           << (statistics.syncFd ? " (sync files)" : " (host waits)")
+           << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+#include "frame_limiter.h"
+
+// Bounds of how long before a deadline the wait stops sleeping. The margin
+// shrinks by a fraction every frame whose sleep didn't overshoot it.
+static constexpr std::chrono::microseconds minSpinMargin{100};
+static constexpr std::chrono::microseconds maxSpinMargin{4000};
+static constexpr int spinMarginDecay = 64;
+
+static auto milliseconds(const vulkanctx::FrameLimiter::Clock::duration &time)
+    -> double {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+vulkanctx::FrameLimiter::FrameLimiter(const double &framesPerSecond)
+    : period_(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1.0 / framesPerSecond))),
+      spinMargin_(std::chrono::microseconds(1000)) {}
+
+auto vulkanctx::FrameLimiter::wait() -> Clock::time_point {
+    Clock::time_point now = Clock::now();
+    const Clock::time_point next = deadline_ + period_;
+
+    // A frame less than a period late keeps its deadline, is counted as
+    // late and leaves the following ones to catch up
+    const bool resync = frames_ == 0 || now > next + period_;
+
+    if (resync) {
+        // Also after the loop sat idle, e.g. waiting for a redraw
+        resyncs_ += frames_ > 0 ? 1 : 0;
+        deadline_ = now;
+    } else {
+        deadline_ = next;
+    }
+
+    const Clock::time_point wakeUp = deadline_ - spinMargin_;
+
+    if (now < wakeUp) {
+        std::this_thread::sleep_until(wakeUp);
+
+        const Clock::time_point woken = Clock::now();
+        const Clock::duration overshoot = woken - wakeUp;
+
+        slept_ += woken - now;
+        now = woken;
+
+        const Clock::duration decayed =
+            spinMargin_ - spinMargin_ / spinMarginDecay;
+
+        spinMargin_ = std::clamp<Clock::duration>(
+            std::max(overshoot, decayed), minSpinMargin, maxSpinMargin);
+    }
+
+    while (now < deadline_) {
+        std::this_thread::yield();
+
+        const Clock::time_point spinning = Clock::now();
+        spun_ += spinning - now;
+        now = spinning;
+    }
+
+    const Clock::duration lateness = now - deadline_;
+    lateness_ += lateness;
+    maxLateness_ = std::max(maxLateness_, lateness);
+
+    // An interval across a resync says nothing about the pacing
+    if (!resync) {
+        const double interval = milliseconds(now - lastStart_);
+
+        intervals_++;
+        intervalSum_ += interval;
+        intervalSquares_ += interval * interval;
+    }
+
+    lastStart_ = now;
+    frames_++;
+
+    return now;
+}
+
+auto vulkanctx::FrameLimiter::period() const -> Clock::duration {
+    return period_;
+}
+
+auto vulkanctx::FrameLimiter::report(std::ostream &stream) const -> void {
+    stream << std::fixed << std::setprecision(3) << "Frame limiter at "
+           << 1000.0 / milliseconds(period_) << " fps: " << frames_
+           << " frames, resynced " << resyncs_;
+
+    if (frames_ > 0) {
+        stream << ", start error " << milliseconds(lateness_) / frames_
+               << " ms (max " << milliseconds(maxLateness_) << "), slept "
+               << milliseconds(slept_) / frames_ << " ms, spun "
+               << milliseconds(spun_) / frames_ << " ms per frame";
+    }
+
+    if (intervals_ > 0) {
+        const double mean = intervalSum_ / intervals_;
+        const double variance =
+            std::max(0.0, intervalSquares_ / intervals_ - mean * mean);
+
+        stream << ", interval " << mean << " ms (jitter "
+               << std::sqrt(variance) << " ms)";
+    }
+
+    stream << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "frame_pacing.h"
+
+static auto milliseconds(const vulkanctx::FramePacing::Clock::duration &time)
+    -> double {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+auto vulkanctx::FramePacing::acquired(const Clock::duration &wait) -> void {
+    acquires_++;
+    acquireWait_ += wait;
+    longestAcquireWait_ = std::max(longestAcquireWait_, wait);
+}
+
+auto vulkanctx::FramePacing::presented(const Clock::time_point &time)
+    -> void {
+    if (framesPresented_ > 0) {
+        const Clock::duration interval = time - lastPresent_;
+
+        intervals_++;
+        intervalSum_ += interval;
+        shortestInterval_ = std::min(shortestInterval_, interval);
+        longestInterval_ = std::max(longestInterval_, interval);
+    }
+
+    lastPresent_ = time;
+    framesPresented_++;
+}
+
+auto vulkanctx::FramePacing::dropped() -> void {
+    framesDropped_++;
+}
+
+auto vulkanctx::FramePacing::latency(const Clock::duration &inputToPresent,
+                                     const bool &onScreen) -> void {
+    latencies_++;
+    latencySum_ += inputToPresent;
+    longestLatency_ = std::max(longestLatency_, inputToPresent);
+    latencyOnScreen_ = onScreen;
+}
+
+auto vulkanctx::FramePacing::report(std::ostream &stream,
+                                    const std::string &name) const -> void {
+    stream << name << ": presented " << framesPresented_ << " frames, dropped "
+           << framesDropped_;
+
+    if (acquires_ > 0) {
+        stream << std::fixed << std::setprecision(3) << ", acquire "
+               << milliseconds(acquireWait_) / acquires_ << " ms (max "
+               << milliseconds(longestAcquireWait_) << ")";
+    }
+
+    if (intervals_ > 0) {
+        stream << std::fixed << std::setprecision(3) << ", interval "
+               << milliseconds(intervalSum_) / intervals_ << " ms ("
+               << milliseconds(shortestInterval_) << " - "
+               << milliseconds(longestInterval_) << ")";
+    }
+
+    if (latencies_ > 0) {
+        stream << std::fixed << std::setprecision(3) << ", latency "
+               << milliseconds(latencySum_) / latencies_ << " ms (max "
+               << milliseconds(longestLatency_)
+               << (latencyOnScreen_ ? ", to screen)" : ", to present)");
+    }
+
+    stream << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,454 @@
+#include <stdexcept>
+
+#include "debug_utils.h"
+#include "device_dispatch.h"
+#include "frame_readback.h"
+#include "host_allocator.h"
+#include "resource_state.h"
+
+// Matches the push constants of shaders/yuv420.comp.glsl
+struct ConversionParameters {
+    uint32_t width;
+    uint32_t height;
+};
+
+// Size of the blocks one invocation and one workgroup of the shader convert
+static constexpr uint32_t blockWidth = 8;
+static constexpr uint32_t blockHeight = 2;
+static constexpr uint32_t groupSize = 8;
+
+static auto bytesPerPixel(const VkFormat &format) -> VkDeviceSize {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return 4;
+    default:
+        throw std::runtime_error("Unsupported swap chain format for readback");
+    }
+}
+
+static auto isSrgb(const VkFormat &format) -> bool {
+    return format == VK_FORMAT_R8G8B8A8_SRGB ||
+           format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+vulkanctx::FrameReadback::FrameReadback(const VkDevice &device,
+                                        const VkPhysicalDevice &physicalDevice,
+                                        const VkCommandPool &commandPool,
+                                        const uint32_t &slotCount,
+                                        ReadbackConsumer consumer,
+                                        const ReadbackFormat &readbackFormat)
+    : device_(device), physicalDevice_(physicalDevice),
+      commandPool_(commandPool), consumer_(std::move(consumer)),
+      readbackFormat_(readbackFormat), slots_(slotCount) {
+    if (readbackFormat_ != ReadbackFormat::Native) {
+        createSampler();
+    }
+}
+
+auto vulkanctx::FrameReadback::createSampler() -> void {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    VkSampler sampler;
+    if (vkCreateSampler(device_, &samplerInfo, hostAllocator(), &sampler) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create readback sampler");
+    }
+
+    sampler_ = UniqueSampler(device_, sampler);
+}
+
+auto vulkanctx::FrameReadback::createConversion(const bool &srgb) -> void {
+    // The layout and whether the samples need encoding again are
+    // specialization constants, so each pipeline only contains the stores
+    // and math it needs
+    conversion_ = createComputePipeline(
+        device_,
+        readShaderFile("shaders/yuv420.comp.spv"),
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER},
+        sizeof(ConversionParameters),
+        {{0, readbackFormat_ == ReadbackFormat::I420 ? VK_TRUE : VK_FALSE},
+         {1, srgb ? VK_TRUE : VK_FALSE}});
+    conversionSrgb_ = srgb;
+}
+
+auto vulkanctx::FrameReadback::prepare(const SwapChainResources &resources,
+                                       DeletionQueue &deletionQueue,
+                                       const uint64_t &lastUsedFrame) -> void {
+    const SwapChain &swapChain = resources.swapChain;
+    const bool convert = readbackFormat_ != ReadbackFormat::Native;
+
+    if (!(swapChain.usage & (convert ? VK_IMAGE_USAGE_SAMPLED_BIT
+                                     : VK_IMAGE_USAGE_TRANSFER_SRC_BIT))) {
+        throw std::runtime_error("Swap chain images can't be read back");
+    }
+
+    extent_ = swapChain.extent;
+    imageCount_ = static_cast<uint32_t>(resources.images.size());
+
+    VkDeviceSize size;
+
+    if (convert) {
+        if (extent_.width % blockWidth != 0 ||
+            extent_.height % blockHeight != 0) {
+            throw std::runtime_error(
+                "Swap chain extent can't be converted to 4:2:0");
+        }
+
+        // Views of a UNORM swap chain already sample the encoded values
+        const bool srgb = isSrgb(swapChain.format);
+
+        if (!conversion_.handle || conversionSrgb_ != srgb) {
+            deletionQueue.retire(lastUsedFrame, std::move(conversion_.handle));
+            deletionQueue.retire(lastUsedFrame, std::move(conversion_.layout));
+            deletionQueue.retire(lastUsedFrame,
+                                 std::move(conversion_.descriptorSetLayout));
+            createConversion(srgb);
+        }
+
+        format_ = readbackFormat_ == ReadbackFormat::NV12
+                      ? VK_FORMAT_G8_B8R8_2PLANE_420_UNORM
+                      : VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM;
+        rowPitch_ = extent_.width;
+        size = rowPitch_ * extent_.height * 3 / 2;
+    } else {
+        format_ = swapChain.format;
+        rowPitch_ = extent_.width * bytesPerPixel(format_);
+        size = rowPitch_ * extent_.height;
+    }
+
+    const VkBufferUsageFlags usage = convert
+                                         ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                                         : VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    for (auto &slot : slots_) {
+        if (slot.frame != 0) {
+            framesDropped_++;
+            slot.frame = 0;
+        }
+
+        // A change of format always comes with a change of size
+        if (slot.buffer.handle && slot.buffer.size == size) {
+            continue;
+        }
+
+        deletionQueue.retire(lastUsedFrame, std::move(slot.buffer.handle));
+        deletionQueue.retire(lastUsedFrame, std::move(slot.buffer.memory));
+
+        // Cached memory makes the CPU reads fast; it is usually not coherent,
+        // which collect() accounts for
+        slot.buffer = createBuffer(device_,
+                                   physicalDevice_,
+                                   size,
+                                   usage,
+                                   {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                        VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT});
+
+        if (vkMapMemory(device_,
+                        slot.buffer.memory,
+                        0,
+                        VK_WHOLE_SIZE,
+                        0,
+                        &slot.mapped) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map readback buffer");
+        }
+    }
+
+    deletionQueue.retire(lastUsedFrame, std::move(commandBuffers_));
+
+    std::vector<VkCommandBuffer> commandBuffers(slots_.size() * imageCount_);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool_;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+    if (vkAllocateCommandBuffers(device_, &allocInfo, commandBuffers.data()) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create readback command buffers");
+    }
+
+    commandBuffers_.clear();
+    commandBuffers_.reserve(commandBuffers.size());
+
+    for (const auto &commandBuffer : commandBuffers) {
+        commandBuffers_.push_back(UniqueCommandBuffer(
+            CommandBufferParent{device_, commandPool_}, commandBuffer));
+    }
+
+    if (!convert) {
+        for (size_t slot = 0; slot < slots_.size(); slot++) {
+            for (size_t image = 0; image < imageCount_; image++) {
+                record(commandBuffers[slot * imageCount_ + image],
+                       resources.images[image],
+                       slots_[slot].buffer.handle);
+            }
+        }
+
+        return;
+    }
+
+    deletionQueue.retire(lastUsedFrame, std::move(descriptorPool_));
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = allocInfo.commandBufferCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = allocInfo.commandBufferCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = allocInfo.commandBufferCount;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    VkDescriptorPool descriptorPool;
+    if (vkCreateDescriptorPool(
+            device_, &poolInfo, hostAllocator(), &descriptorPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool");
+    }
+
+    descriptorPool_ = UniqueDescriptorPool(device_, descriptorPool);
+
+    std::vector<VkDescriptorSetLayout> layouts(
+        commandBuffers.size(), conversion_.descriptorSetLayout);
+    std::vector<VkDescriptorSet> descriptorSets(commandBuffers.size());
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = allocInfo.commandBufferCount;
+    setInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device_, &setInfo, descriptorSets.data()) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets");
+    }
+
+    for (size_t slot = 0; slot < slots_.size(); slot++) {
+        for (size_t image = 0; image < imageCount_; image++) {
+            const size_t index = slot * imageCount_ + image;
+
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.sampler = sampler_;
+            imageInfo.imageView = resources.imageViews[image];
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = slots_[slot].buffer.handle;
+            bufferInfo.offset = 0;
+            bufferInfo.range = VK_WHOLE_SIZE;
+
+            VkWriteDescriptorSet writes[2]{};
+            writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[0].dstSet = descriptorSets[index];
+            writes[0].dstBinding = 0;
+            writes[0].descriptorCount = 1;
+            writes[0].descriptorType =
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[0].pImageInfo = &imageInfo;
+
+            writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[1].dstSet = descriptorSets[index];
+            writes[1].dstBinding = 1;
+            writes[1].descriptorCount = 1;
+            writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[1].pBufferInfo = &bufferInfo;
+
+            vkUpdateDescriptorSets(device_, 2, writes, 0, nullptr);
+
+            recordConversion(commandBuffers[index],
+                             resources.images[image],
+                             slots_[slot].buffer.handle,
+                             descriptorSets[index]);
+        }
+    }
+}
+
+auto vulkanctx::FrameReadback::record(const VkCommandBuffer &commandBuffer,
+                                      const VkImage &image,
+                                      const VkBuffer &buffer) const -> void {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording readback.");
+    }
+
+    ResourceStateTracker tracker;
+
+    // The render pass's outgoing dependency already made the color writes
+    // visible to transfers, what is left is the layout change. The buffer is
+    // only read by the host after the frame's fence signaled.
+    tracker.trackImage(image,
+                       VK_IMAGE_ASPECT_COLOR_BIT,
+                       1,
+                       1,
+                       {VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                        VK_ACCESS_2_TRANSFER_READ_BIT,
+                        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    tracker.trackBuffer(buffer, {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE});
+
+    tracker.useImage(image,
+                     {VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                      VK_ACCESS_2_TRANSFER_READ_BIT,
+                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL});
+    tracker.useBuffer(
+        buffer,
+        {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT});
+    tracker.flush(commandBuffer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent_.width, extent_.height, 1};
+
+    {
+        DebugLabel label(commandBuffer, "readback");
+        vkCmdCopyImageToBuffer(commandBuffer,
+                               image,
+                               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               buffer,
+                               1,
+                               &region);
+    }
+
+    tracker.useImage(image,
+                     {VK_PIPELINE_STAGE_2_NONE,
+                      VK_ACCESS_2_NONE,
+                      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    tracker.useBuffer(
+        buffer, {VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT});
+    tracker.flush(commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record readback command buffer");
+    }
+}
+
+auto vulkanctx::FrameReadback::recordConversion(
+    const VkCommandBuffer &commandBuffer,
+    const VkImage &image,
+    const VkBuffer &buffer,
+    const VkDescriptorSet &descriptorSet) const -> void {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording readback.");
+    }
+
+    ResourceStateTracker tracker;
+
+    // As with the copy, the render pass already made the color writes
+    // visible to compute shaders
+    tracker.trackImage(image,
+                       VK_IMAGE_ASPECT_COLOR_BIT,
+                       1,
+                       1,
+                       {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_2_SHADER_READ_BIT,
+                        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    tracker.trackBuffer(buffer, {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE});
+
+    tracker.useImage(image,
+                     {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                      VK_ACCESS_2_SHADER_READ_BIT,
+                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+    tracker.useBuffer(buffer,
+                      {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                       VK_ACCESS_2_SHADER_WRITE_BIT});
+    tracker.flush(commandBuffer);
+
+    ConversionParameters parameters{extent_.width, extent_.height};
+
+    {
+        DebugLabel label(commandBuffer, "readback conversion");
+        recordDispatch(commandBuffer,
+                       conversion_,
+                       descriptorSet,
+                       &parameters,
+                       {groupCount(extent_.width / blockWidth, groupSize),
+                        groupCount(extent_.height / blockHeight, groupSize),
+                        1});
+    }
+
+    tracker.useImage(image,
+                     {VK_PIPELINE_STAGE_2_NONE,
+                      VK_ACCESS_2_NONE,
+                      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    tracker.useBuffer(
+        buffer, {VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT});
+    tracker.flush(commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record readback command buffer");
+    }
+}
+
+auto vulkanctx::FrameReadback::commandBuffer(const uint32_t &slot,
+                                             const uint32_t &imageIndex) const
+    -> VkCommandBuffer {
+    return commandBuffers_[slot * imageCount_ + imageIndex];
+}
+
+auto vulkanctx::FrameReadback::submitted(const uint32_t &slot,
+                                         const uint64_t &frame) -> void {
+    slots_[slot].frame = frame;
+}
+
+auto vulkanctx::FrameReadback::collect(const uint32_t &slot) -> void {
+    Slot &current = slots_[slot];
+
+    if (current.frame == 0) {
+        return;
+    }
+
+    if (!(current.buffer.properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = current.buffer.memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+
+        vkInvalidateMappedMemoryRanges(device_, 1, &range);
+    }
+
+    consumer_(ReadbackFrame{current.frame,
+                            extent_,
+                            format_,
+                            static_cast<const uint8_t *>(current.mapped),
+                            rowPitch_,
+                            current.buffer.size});
+
+    current.frame = 0;
+    framesRead_++;
+}
+
+auto vulkanctx::FrameReadback::framesRead() const -> uint64_t {
+    return framesRead_;
+}
+
+auto vulkanctx::FrameReadback::framesDropped() const -> uint64_t {
+    return framesDropped_;
+}
@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <new>
+
+#include "host_allocator.h"
+
+// ---------------------------------------------------------------------------//
+//                              Size class pools                              //
+// ---------------------------------------------------------------------------//
+
+namespace {
+
+constexpr size_t headerSize = 16;
+constexpr size_t pooledAlignment = 16;
+constexpr size_t sizeClassCount = 8;
+constexpr size_t sizeClasses[sizeClassCount] = {
+    16, 32, 64, 128, 256, 512, 1024, 2048};
+constexpr uint16_t unpooled = UINT16_MAX;
+
+constexpr size_t chunkSize = 64 * 1024;
+constexpr size_t threadCacheLimit = 128;
+constexpr size_t refillCount = 32;
+
+// Precedes every block handed to the driver. Offset is the distance from the
+// start of the underlying allocation to the user pointer.
+struct Header {
+    uint64_t size;
+    uint16_t sizeClass;
+    uint16_t scope;
+    uint32_t offset;
+};
+
+static_assert(sizeof(Header) == headerSize, "Header has to be 16 bytes");
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+auto sizeClassOf(size_t size) -> uint16_t {
+    for (uint16_t i = 0; i < sizeClassCount; i++) {
+        if (size <= sizeClasses[i]) {
+            return i;
+        }
+    }
+
+    return unpooled;
+}
+
+auto headerOf(void *memoryPtr) -> Header * {
+    return reinterpret_cast<Header *>(static_cast<char *>(memoryPtr) -
+                                      headerSize);
+}
+
+// Shared by all threads and guarded by a single mutex. Only touched when a
+// thread cache runs empty or overflows.
+class GlobalPool {
+  public:
+    auto take(uint16_t sizeClass, FreeBlock *&list, size_t count) -> size_t {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        size_t taken = 0;
+        while (taken < count) {
+            if (freeLists_[sizeClass] == nullptr) {
+                carve(sizeClass);
+            }
+
+            FreeBlock *block = freeLists_[sizeClass];
+            freeLists_[sizeClass] = block->next;
+            block->next = list;
+            list = block;
+            taken++;
+        }
+
+        return taken;
+    }
+
+    auto give(uint16_t sizeClass, FreeBlock *first, FreeBlock *last) -> void {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last->next = freeLists_[sizeClass];
+        freeLists_[sizeClass] = first;
+    }
+
+  private:
+    // Chunks are never returned to the system; the pools only grow to the
+    // high water mark of the application
+    auto carve(uint16_t sizeClass) -> void {
+        size_t blockSize = headerSize + sizeClasses[sizeClass];
+        char *chunk = static_cast<char *>(
+            ::operator new(chunkSize, std::align_val_t(pooledAlignment)));
+
+        for (size_t offset = 0; offset + blockSize <= chunkSize;
+             offset += blockSize) {
+            auto block = reinterpret_cast<FreeBlock *>(chunk + offset);
+            block->next = freeLists_[sizeClass];
+            freeLists_[sizeClass] = block;
+        }
+    }
+
+    std::mutex mutex_;
+    FreeBlock *freeLists_[sizeClassCount] = {};
+};
+
+// Deliberately leaked so that thread caches torn down late during process exit
+// can still hand their blocks back
+auto globalPool() -> GlobalPool & {
+    static GlobalPool *pool = new GlobalPool;
+    return *pool;
+}
+
+class ThreadCache {
+  public:
+    ~ThreadCache() {
+        for (uint16_t i = 0; i < sizeClassCount; i++) {
+            if (lists_[i] != nullptr) {
+                release(i, counts_[i]);
+            }
+        }
+    }
+
+    auto pop(uint16_t sizeClass) -> void * {
+        if (lists_[sizeClass] == nullptr) {
+            counts_[sizeClass] +=
+                globalPool().take(sizeClass, lists_[sizeClass], refillCount);
+        }
+
+        FreeBlock *block = lists_[sizeClass];
+        lists_[sizeClass] = block->next;
+        counts_[sizeClass]--;
+
+        return block;
+    }
+
+    auto push(uint16_t sizeClass, void *blockPtr) -> void {
+        auto block = static_cast<FreeBlock *>(blockPtr);
+        block->next = lists_[sizeClass];
+        lists_[sizeClass] = block;
+
+        if (++counts_[sizeClass] > threadCacheLimit) {
+            release(sizeClass, threadCacheLimit / 2);
+        }
+    }
+
+  private:
+    auto release(uint16_t sizeClass, size_t count) -> void {
+        FreeBlock *first = lists_[sizeClass];
+        FreeBlock *last = first;
+
+        for (size_t i = 1; i < count; i++) {
+            last = last->next;
+        }
+
+        lists_[sizeClass] = last->next;
+        counts_[sizeClass] -= count;
+        globalPool().give(sizeClass, first, last);
+    }
+
+    FreeBlock *lists_[sizeClassCount] = {};
+    size_t counts_[sizeClassCount] = {};
+};
+
+thread_local ThreadCache threadCache;
+
+auto allocateBlock(size_t size,
+                   size_t alignment,
+                   VkSystemAllocationScope scope,
+                   bool &pooled) -> void * {
+    uint16_t sizeClass = sizeClassOf(size);
+    pooled = sizeClass != unpooled && alignment <= pooledAlignment;
+
+    char *base;
+    size_t offset;
+
+    if (pooled) {
+        base = static_cast<char *>(threadCache.pop(sizeClass));
+        offset = headerSize;
+    } else {
+        // Leave room for the header while keeping the user pointer aligned
+        alignment = std::max(alignment, pooledAlignment);
+        offset = std::max(alignment, headerSize);
+        size_t total = (offset + size + alignment - 1) / alignment * alignment;
+
+        base = static_cast<char *>(std::aligned_alloc(alignment, total));
+        if (base == nullptr) {
+            return nullptr;
+        }
+
+        sizeClass = unpooled;
+    }
+
+    void *memoryPtr = base + offset;
+    *headerOf(memoryPtr) = Header{size,
+                                  sizeClass,
+                                  static_cast<uint16_t>(scope),
+                                  static_cast<uint32_t>(offset)};
+
+    return memoryPtr;
+}
+
+auto freeBlock(void *memoryPtr) -> void {
+    Header header = *headerOf(memoryPtr);
+    char *base = static_cast<char *>(memoryPtr) - header.offset;
+
+    if (header.sizeClass != unpooled) {
+        threadCache.push(header.sizeClass, base);
+    } else {
+        std::free(base);
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------//
+//                                 Allocator                                  //
+// ---------------------------------------------------------------------------//
+
+vulkanctx::HostAllocator::HostAllocator() {
+    callbacks_ = {};
+    callbacks_.pUserData = this;
+    callbacks_.pfnAllocation = &HostAllocator::allocate;
+    callbacks_.pfnReallocation = &HostAllocator::reallocate;
+    callbacks_.pfnFree = &HostAllocator::free;
+}
+
+auto vulkanctx::HostAllocator::callbacks() const
+    -> const VkAllocationCallbacks * {
+    return &callbacks_;
+}
+
+auto VKAPI_CALL vulkanctx::HostAllocator::allocate(
+    void *userDataPtr,
+    size_t size,
+    size_t alignment,
+    VkSystemAllocationScope scope) -> void * {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    auto allocator = static_cast<HostAllocator *>(userDataPtr);
+
+    bool pooled;
+    void *memoryPtr = allocateBlock(size, alignment, scope, pooled);
+
+    if (memoryPtr != nullptr) {
+        allocator->countAllocation(scope, size, pooled);
+    }
+
+    return memoryPtr;
+}
+
+auto VKAPI_CALL vulkanctx::HostAllocator::reallocate(
+    void *userDataPtr,
+    void *originalPtr,
+    size_t size,
+    size_t alignment,
+    VkSystemAllocationScope scope) -> void * {
+    auto allocator = static_cast<HostAllocator *>(userDataPtr);
+
+    if (originalPtr == nullptr) {
+        return allocate(userDataPtr, size, alignment, scope);
+    }
+
+    if (size == 0) {
+        free(userDataPtr, originalPtr);
+        return nullptr;
+    }
+
+    Header *header = headerOf(originalPtr);
+    auto originalScope = static_cast<VkSystemAllocationScope>(header->scope);
+    allocator->counters_[originalScope].reallocations.fetch_add(
+        1, std::memory_order_relaxed);
+
+    // Growing or shrinking within the same size class needs no copy
+    if (header->sizeClass != unpooled && alignment <= pooledAlignment &&
+        sizeClassOf(size) == header->sizeClass) {
+        Counters &counters = allocator->counters_[originalScope];
+        counters.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+        addLiveBytes(counters, size);
+        header->size = size;
+
+        return originalPtr;
+    }
+
+    void *memoryPtr = allocate(userDataPtr, size, alignment, originalScope);
+    if (memoryPtr == nullptr) {
+        return nullptr;
+    }
+
+    std::memcpy(memoryPtr,
+                originalPtr,
+                std::min(static_cast<size_t>(header->size), size));
+    free(userDataPtr, originalPtr);
+
+    return memoryPtr;
+}
+
+auto VKAPI_CALL vulkanctx::HostAllocator::free(void *userDataPtr,
+                                               void *memoryPtr) -> void {
+    if (memoryPtr == nullptr) {
+        return;
+    }
+
+    auto allocator = static_cast<HostAllocator *>(userDataPtr);
+    Header *header = headerOf(memoryPtr);
+
+    allocator->countFree(static_cast<VkSystemAllocationScope>(header->scope),
+                         header->size);
+    freeBlock(memoryPtr);
+}
+
+auto vulkanctx::HostAllocator::countAllocation(VkSystemAllocationScope scope,
+                                               size_t size,
+                                               bool pooled) -> void {
+    Counters &counters = counters_[scope];
+
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    if (pooled) {
+        counters.pooledAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    addLiveBytes(counters, size);
+}
+
+auto vulkanctx::HostAllocator::addLiveBytes(Counters &counters, size_t size)
+    -> void {
+    uint64_t live =
+        counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+
+    while (live > peak && !counters.peakBytes.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+auto vulkanctx::HostAllocator::countFree(VkSystemAllocationScope scope,
+                                         size_t size) -> void {
+    counters_[scope].frees.fetch_add(1, std::memory_order_relaxed);
+    counters_[scope].liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+auto vulkanctx::HostAllocator::snapshot() const -> HostAllocationSnapshot {
+    HostAllocationSnapshot snapshot;
+
+    for (size_t i = 0; i < allocationScopeCount; i++) {
+        const Counters &counters = counters_[i];
+        snapshot[i].allocations = counters.allocations.load();
+        snapshot[i].reallocations = counters.reallocations.load();
+        snapshot[i].frees = counters.frees.load();
+        snapshot[i].liveBytes = counters.liveBytes.load();
+        snapshot[i].peakBytes = counters.peakBytes.load();
+        snapshot[i].pooledAllocations = counters.pooledAllocations.load();
+    }
+
+    return snapshot;
+}
+
+auto vulkanctx::HostAllocator::report(std::ostream &stream,
+                                      const HostAllocationSnapshot *baseline)
+    const -> void {
+    static const char *scopeNames[allocationScopeCount] = {
+        "command", "object", "cache", "device", "instance"};
+
+    auto current = snapshot();
+    HostAllocationSnapshot zero{};
+    const HostAllocationSnapshot &from = baseline ? *baseline : zero;
+
+    const auto flags = stream.flags();
+    stream << "Host allocations" << (baseline ? " (since baseline)" : "")
+           << ":" << std::endl;
+    stream << "  " << std::left << std::setw(10) << "scope" << std::right
+           << std::setw(10) << "allocs" << std::setw(10) << "pooled"
+           << std::setw(10) << "reallocs" << std::setw(10) << "frees"
+           << std::setw(12) << "live B" << std::setw(12) << "peak B"
+           << std::endl;
+
+    for (size_t i = 0; i < allocationScopeCount; i++) {
+        stream << "  " << std::left << std::setw(10) << scopeNames[i]
+               << std::right << std::setw(10)
+               << current[i].allocations - from[i].allocations
+               << std::setw(10)
+               << current[i].pooledAllocations - from[i].pooledAllocations
+               << std::setw(10)
+               << current[i].reallocations - from[i].reallocations
+               << std::setw(10) << current[i].frees - from[i].frees
+               << std::setw(12) << current[i].liveBytes << std::setw(12)
+               << current[i].peakBytes << std::endl;
+    }
+
+    stream.flags(flags);
+}
+
+// ---------------------------------------------------------------------------//
+//                               Installation                                 //
+// ---------------------------------------------------------------------------//
+
+static std::atomic<const VkAllocationCallbacks *> installedAllocator{
+    vulkanctx::defaultHostAllocator().callbacks()};
+
+auto vulkanctx::defaultHostAllocator() -> HostAllocator & {
+    static HostAllocator allocator;
+    return allocator;
+}
+
+auto vulkanctx::hostAllocator() -> const VkAllocationCallbacks * {
+    return installedAllocator.load(std::memory_order_relaxed);
+}
+
+auto vulkanctx::setHostAllocator(const VkAllocationCallbacks *allocator)
+    -> void {
+    installedAllocator.store(allocator, std::memory_order_relaxed);
+}
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <stdexcept>
+
+#include "job_system.h"
+
+constexpr size_t dequeCapacity = 4096;
+
+// Index of the worker running on this thread in its job system, if any
+static thread_local const vulkanctx::JobSystem *currentSystem = nullptr;
+static thread_local size_t currentWorker = 0;
+
+auto vulkanctx::JobCounter::done() const -> bool {
+    return pending_.load(std::memory_order_acquire) == 0;
+}
+
+// ---------------------------------------------------------------------------//
+//                                   Deque                                    //
+// ---------------------------------------------------------------------------//
+
+// Follows "Correct and Efficient Work-Stealing for Weak Memory Models" by Le
+// et al. The slots are released and acquired on top of the fences so that the
+// job contents are visibly published to thread sanitizer as well.
+
+vulkanctx::JobSystem::Deque::Deque(const size_t &capacity)
+    : jobs_(new std::atomic<Job *>[capacity]),
+      mask_(static_cast<int64_t>(capacity) - 1) {}
+
+auto vulkanctx::JobSystem::Deque::push(Job *job) -> bool {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+
+    if (bottom - top > mask_) {
+        return false;
+    }
+
+    jobs_[bottom & mask_].store(job, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+auto vulkanctx::JobSystem::Deque::pop() -> Job * {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job = jobs_[bottom & mask_].load(std::memory_order_relaxed);
+
+    // The last job, which a thief may be taking at the same time
+    if (top == bottom) {
+        if (!top_.compare_exchange_strong(top,
+                                          top + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+auto vulkanctx::JobSystem::Deque::steal() -> Job * {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job *job = jobs_[top & mask_].load(std::memory_order_acquire);
+
+    // Lost the race against the owner or another thief
+    if (!top_.compare_exchange_strong(top,
+                                      top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    return job;
+}
+
+// ---------------------------------------------------------------------------//
+//                                 Job system                                 //
+// ---------------------------------------------------------------------------//
+
+vulkanctx::JobSystem::JobSystem(size_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        workerCount = std::max<size_t>(workerCount, 1);
+    }
+
+    for (size_t i = 0; i < workerCount; i++) {
+        deques_.push_back(std::make_unique<Deque>(dequeCapacity));
+    }
+
+    // Only started once every deque exists, as workers steal from all
+    for (size_t i = 0; i < workerCount; i++) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+vulkanctx::JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_.store(true, std::memory_order_seq_cst);
+    }
+
+    wakeup_.notify_all();
+
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+auto vulkanctx::JobSystem::spawn(JobCounter &counter,
+                                 std::function<void()> function) -> void {
+    counter.pending_.fetch_add(1, std::memory_order_relaxed);
+
+    Job *job = new Job{std::move(function), &counter};
+
+    if (currentSystem == this) {
+        if (!deques_[currentWorker]->push(job)) {
+            execute(job);
+            return;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(injectedMutex_);
+        injected_.push_back(job);
+        injectedCount_.fetch_add(1, std::memory_order_release);
+    }
+
+    notify();
+}
+
+auto vulkanctx::JobSystem::notify() -> void {
+    // Pairs with the sleeper registering itself before checking the epoch,
+    // so either this sees the sleeper or the sleeper sees the new epoch
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wakeup_.notify_one();
+    }
+}
+
+auto vulkanctx::JobSystem::findJob(const size_t &self) -> Job * {
+    if (currentSystem == this) {
+        if (Job *job = deques_[self]->pop()) {
+            return job;
+        }
+    }
+
+    if (injectedCount_.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(injectedMutex_);
+
+        if (!injected_.empty()) {
+            Job *job = injected_.back();
+            injected_.pop_back();
+            injectedCount_.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // Start at the neighbour so that thieves spread over the victims
+    const size_t count = deques_.size();
+
+    for (size_t i = 1; i <= count; i++) {
+        const size_t victim = (self + i) % count;
+
+        if (currentSystem == this && victim == self) {
+            continue;
+        }
+
+        if (Job *job = deques_[victim]->steal()) {
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+auto vulkanctx::JobSystem::execute(Job *job) -> void {
+    JobCounter *counter = job->counter;
+
+    try {
+        job->function();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(counter->errorMutex_);
+
+        if (!counter->error_) {
+            counter->error_ = std::current_exception();
+        }
+    }
+
+    delete job;
+
+    counter->pending_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+auto vulkanctx::JobSystem::workerLoop(const size_t &index) -> void {
+    currentSystem = this;
+    currentWorker = index;
+
+    while (true) {
+        const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+
+        if (Job *job = findJob(index)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+
+        if (stopping_.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        wakeup_.wait(lock, [&] {
+            return stopping_.load(std::memory_order_relaxed) ||
+                   epoch_.load(std::memory_order_seq_cst) != epoch;
+        });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Spawned work is always finished, even on the way out
+    while (Job *job = findJob(index)) {
+        execute(job);
+    }
+}
+
+auto vulkanctx::JobSystem::wait(JobCounter &counter) -> void {
+    const size_t self = currentSystem == this ? currentWorker : 0;
+
+    while (!counter.done()) {
+        if (Job *job = findJob(self)) {
+            execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(counter.errorMutex_);
+
+    if (counter.error_) {
+        std::exception_ptr error = counter.error_;
+        counter.error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+auto vulkanctx::JobSystem::parallelFor(
+    const size_t &count,
+    const size_t &grain,
+    const std::function<void(size_t, size_t)> &body) -> void {
+    const size_t step = std::max<size_t>(grain, 1);
+
+    if (count <= step) {
+        body(0, count);
+        return;
+    }
+
+    JobCounter counter;
+
+    // The caller takes the first range itself rather than idling in wait
+    for (size_t begin = step; begin < count; begin += step) {
+        const size_t end = std::min(begin + step, count);
+        spawn(counter, [&body, begin, end] { body(begin, end); });
+    }
+
+    try {
+        body(0, step);
+    } catch (...) {
+        // The other ranges still reference body and the counter
+        wait(counter);
+        throw;
+    }
+
+    wait(counter);
+}
+
+auto vulkanctx::JobSystem::workerCount() const -> size_t {
+    return workers_.size();
+}
+
+auto vulkanctx::jobSystem() -> JobSystem & {
+    static JobSystem system([] {
+        const char *threads = std::getenv("VULKANCTX_JOB_THREADS");
+        return threads != nullptr ? std::strtoull(threads, nullptr, 10) : 0;
+    }());
+
+    return system;
+}
+
+// ---------------------------------------------------------------------------//
+//                                 Benchmark                                  //
+// ---------------------------------------------------------------------------//
+
+template <typename Function>
+static auto nanosecondsPerTask(const size_t &taskCount, Function function)
+    -> double {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           static_cast<double>(taskCount);
+}
+
+auto vulkanctx::runJobBenchmark(const size_t &taskCount, std::ostream &stream)
+    -> void {
+    JobSystem &system = jobSystem();
+    std::atomic<uint64_t> sink{0};
+
+    auto task = [&sink] { sink.fetch_add(1, std::memory_order_relaxed); };
+
+    double injected = nanosecondsPerTask(taskCount, [&] {
+        JobCounter counter;
+
+        for (size_t i = 0; i < taskCount; i++) {
+            system.spawn(counter, task);
+        }
+
+        system.wait(counter);
+    });
+
+    // One job fans out from a worker, so the children go to its deque and
+    // reach the other workers by stealing
+    double stolen = nanosecondsPerTask(taskCount, [&] {
+        JobCounter root;
+
+        system.spawn(root, [&] {
+            JobCounter children;
+
+            for (size_t i = 0; i < taskCount; i++) {
+                system.spawn(children, task);
+            }
+
+            system.wait(children);
+        });
+
+        system.wait(root);
+    });
+
+    double parallel = nanosecondsPerTask(taskCount, [&] {
+        system.parallelFor(taskCount, 1, [&](size_t begin, size_t end) {
+            sink.fetch_add(end - begin, std::memory_order_relaxed);
+        });
+    });
+
+    stream << std::fixed << std::setprecision(1) << "Job system with "
+           << system.workerCount() << " workers, " << taskCount
+           << " empty tasks:\n"
+           << "  spawned from outside  " << injected << " ns per task\n"
+           << "  spawned by a worker   " << stolen << " ns per task\n"
+           << "  parallelFor, grain 1  " << parallel << " ns per task"
+           << std::defaultfloat << std::endl;
+
+    if (sink.load() != 3 * taskCount) {
+        throw std::runtime_error("Job benchmark lost tasks");
+    }
+}
@@ -1,106 +1,1059 @@
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "async_compute.h"
+#include "device_dispatch.h"
+#include "device_features.h"
+#include "diagnostics.h"
+#include "fixed_step_simulation.h"
+#include "frame_depth.h"
+#include "frame_export.h"
+#include "frame_limiter.h"
+#include "frame_readback.h"
+#include "host_allocator.h"
+#include "job_system.h"
+#include "object_tracker.h"
+#include "redraw_scheduler.h"
+#include "render_thread.h"
+#include "startup_profiler.h"
+#include "video_writer.h"
 #include "vulkan_context.h"
 
-#define MAX_FRAMES_IN_FLIGHT 2
-#define APP_NAME             "Vulkan"
-#define WIDTH                800
-#define HEIGHT               600
+#define APP_NAME "Vulkan"
+#define WIDTH    800
+#define HEIGHT   600
 
 namespace app {
 
-auto initializeWindow(const int width, const int height, const char *title)
-    -> GLFWwindow * {
+// VULKANCTX_WINDOWS opens several windows, all drawn by the one device
+auto windowCount() -> size_t {
+    const char *count = std::getenv("VULKANCTX_WINDOWS");
+
+    if (count == nullptr) {
+        return 1;
+    }
+
+    return std::max<size_t>(1, std::strtoull(count, nullptr, 10));
+}
+
+// Of the primary monitor, 0 if there is none
+auto refreshRate() -> double {
+    GLFWmonitor *monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode *mode =
+        monitor != nullptr ? glfwGetVideoMode(monitor) : nullptr;
+
+    return mode != nullptr ? mode->refreshRate : 0.0;
+}
+
+// VULKANCTX_FPS caps the frame rate, 0 turns the cap off. It defaults to
+// the refresh rate of the primary monitor, as with mailbox presents nothing
+// else would hold the loop back.
+auto targetFrameRate() -> double {
+    const char *value = std::getenv("VULKANCTX_FPS");
+
+    if (value != nullptr) {
+        return std::max(0.0, std::strtod(value, nullptr));
+    }
+
+    return refreshRate();
+}
+
+// --resize-test resizes the first window through a few extents while frames
+// keep coming, and fails the run if a frame around a swap chain recreation
+// blocked on its fence, its acquires or its present for longer than two
+// present intervals. Out of date swap chains have to be recreated without
+// stalling for that. The frames in between only show how the driver paces
+// presents, so they aren't measured.
+class ResizeTest {
+  public:
+    using Clock = vulkanctx::FramePacing::Clock;
+
+    // The budget of every wait is a multiple of a refresh at the given rate.
+    // A single refresh would fail whenever a wait is barely over, as waiting
+    // for the next present is expected in FIFO.
+    ResizeTest(GLFWwindow *window, const double &refreshRate)
+        : window_(window),
+          budget_(std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(budgetIntervals / refreshRate))) {}
+
+    // Main thread. Moves on to the next extent once the current one was
+    // held long enough, and closes the window after the last.
+    auto tick() -> void {
+        const Clock::time_point now = Clock::now();
+
+        if (step_ > 0 && now - stepStart_ < holdTime) {
+            return;
+        }
+
+        if (step_ == std::size(extents)) {
+            glfwSetWindowShouldClose(window_, GLFW_TRUE);
+            return;
+        }
+
+        glfwSetWindowSize(window_, extents[step_].width, extents[step_].height);
+        stepStart_ = now;
+        step_++;
+    }
+
+    // Render thread, whenever the swap chain of the window was recreated.
+    // The frame before, which may have found it out of date, and the next
+    // few frames are measured.
+    auto recreated() -> void {
+        recreations_++;
+
+        if (frames_ > 0 && remaining_ == 0) {
+            measure(previous_);
+        }
+
+        remaining_ = framesAfterRecreation;
+    }
+
+    // Render thread, after every frame
+    auto frame(const vulkanctx::FrameWaits &waits) -> void {
+        frames_++;
+        previous_ = waits;
+
+        if (remaining_ > 0) {
+            remaining_--;
+            measure(waits);
+        }
+    }
+
+    // Once both threads are done, returns whether the test passed
+    auto report(std::ostream &stream) const -> bool {
+        auto milliseconds = [](const Clock::duration &time) {
+            return std::chrono::duration<double, std::milli>(time).count();
+        };
+
+        stream << std::fixed << std::setprecision(3) << "Resize test: "
+               << recreations_ << " recreations over " << step_
+               << " extents, " << framesMeasured_ << " of " << frames_
+               << " frames measured, longest fence wait "
+               << milliseconds(longest_.fence) << " ms, acquire "
+               << milliseconds(longest_.acquire) << " ms, present "
+               << milliseconds(longest_.present) << " ms, "
+               << framesOverBudget_ << " frames over the budget of "
+               << milliseconds(budget_) << " ms" << std::defaultfloat
+               << std::endl;
+
+        return recreations_ > 0 && framesOverBudget_ == 0;
+    }
+
+  private:
+    struct Extent {
+        int width;
+        int height;
+    };
+
+    static constexpr Extent extents[] = {
+        {640, 480}, {1024, 768}, {320, 240}, {1280, 720}, {WIDTH, HEIGHT}};
+    static constexpr std::chrono::milliseconds holdTime{500};
+    static constexpr double budgetIntervals = 2.0;
+    static constexpr uint32_t framesAfterRecreation = 3;
+
+    auto measure(const vulkanctx::FrameWaits &waits) -> void {
+        framesMeasured_++;
+        longest_.fence = std::max(longest_.fence, waits.fence);
+        longest_.acquire = std::max(longest_.acquire, waits.acquire);
+        longest_.present = std::max(longest_.present, waits.present);
+
+        if (std::max({waits.fence, waits.acquire, waits.present}) > budget_) {
+            framesOverBudget_++;
+        }
+    }
+
+    GLFWwindow *window_;
+    const Clock::duration budget_;
+
+    // Main thread
+    size_t step_ = 0;
+    Clock::time_point stepStart_{};
+
+    // Render thread
+    uint64_t recreations_ = 0;
+    uint32_t remaining_ = 0;
+    vulkanctx::FrameWaits previous_{};
+
+    uint64_t frames_ = 0;
+    uint64_t framesMeasured_ = 0;
+    uint64_t framesOverBudget_ = 0;
+    vulkanctx::FrameWaits longest_{};
+};
+
+struct FramesInFlight {
+    uint32_t count;
+    bool adaptive;
+};
+
+// VULKANCTX_FRAMES_IN_FLIGHT is how many frames the CPU may queue ahead of
+// the GPU, 2 unless set. "auto" has FrameDepthController pick up to 3.
+auto framesInFlight() -> FramesInFlight {
+    const char *value = std::getenv("VULKANCTX_FRAMES_IN_FLIGHT");
+
+    if (value == nullptr) {
+        return {2, false};
+    } else if (strcmp(value, "auto") == 0) {
+        return {3, true};
+    }
+
+    const unsigned long count = std::strtoul(value, nullptr, 10);
+
+    return {static_cast<uint32_t>(std::clamp(count, 1ul, 8ul)), false};
+}
+
+auto initializeWindows(const size_t count,
+                       const int width,
+                       const int height,
+                       const char *title) -> std::vector<GLFWwindow *> {
     glfwInit();
 
     // Don't initialize OpenGL context
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
-    return glfwCreateWindow(width, height, title, nullptr, nullptr);
+    int monitorCount = 0;
+    GLFWmonitor **monitors = glfwGetMonitors(&monitorCount);
+
+    std::vector<GLFWwindow *> windows;
+
+    for (size_t i = 0; i < count; i++) {
+        windows.push_back(
+            glfwCreateWindow(width, height, title, nullptr, nullptr));
+
+        // One window per monitor for as long as there are enough of them
+        if (i < static_cast<size_t>(monitorCount)) {
+            int x, y;
+            glfwGetMonitorPos(monitors[i], &x, &y);
+            glfwSetWindowPos(windows.back(), x, y);
+        }
+    }
+
+    return windows;
 }
 
-auto cleanup(GLFWwindow *window) -> void {
-    glfwDestroyWindow(window);
+auto cleanup(const std::vector<GLFWwindow *> &windows) -> void {
+    for (GLFWwindow *window : windows) {
+        glfwDestroyWindow(window);
+    }
+
     glfwTerminate();
+
+    // Every Vulkan object is gone by now, unless one leaked
+    vulkanctx::objectTracker().report(std::cout);
+    vulkanctx::objectTracker().reportLeaks(std::cerr);
+}
+
+// Modes without a window: sharing rendered frames with another process, see
+// frame_export.h, and benchmarks
+auto runHeadlessMode(int argc, char **argv) -> int {
+    const std::string mode = argv[1];
+    vulkanctx::ExportOptions options;
+
+    if (mode == "--export" && argc >= 3) {
+        if (argc >= 4) {
+            options.frameCount = std::strtoull(argv[3], nullptr, 10);
+        }
+
+        int socket = vulkanctx::acceptExportConsumer(argv[2]);
+        auto statistics =
+            vulkanctx::runExportProducer(APP_NAME, socket, options);
+        vulkanctx::reportExport(std::cout, "producer", statistics);
+    } else if (mode == "--export-consumer" && argc >= 3) {
+        int socket = vulkanctx::connectExportProducer(argv[2]);
+        auto statistics = vulkanctx::runExportConsumer(APP_NAME, socket);
+        vulkanctx::reportExport(std::cout, "consumer", statistics);
+    } else if (mode == "--export-benchmark") {
+        if (argc >= 3) {
+            options.frameCount = std::strtoull(argv[2], nullptr, 10);
+        }
+
+        vulkanctx::runExportBenchmark(APP_NAME, options, std::cout);
+    } else if (mode == "--jobs-benchmark") {
+        size_t taskCount = 100000;
+
+        if (argc >= 3) {
+            taskCount = std::strtoull(argv[2], nullptr, 10);
+        }
+
+        vulkanctx::runJobBenchmark(taskCount, std::cout);
+    } else if (mode == "--dispatch-benchmark") {
+        uint64_t callCount = 1000000;
+
+        if (argc >= 3) {
+            callCount = std::strtoull(argv[2], nullptr, 10);
+        }
+
+        vulkanctx::runDispatchBenchmark(APP_NAME, callCount, std::cout);
+    } else {
+        std::cerr << "Usage: " << argv[0] << "\n"
+                  << "       " << argv[0] << " --export PATH [FRAMES]\n"
+                  << "       " << argv[0] << " --export-consumer PATH\n"
+                  << "       " << argv[0] << " --export-benchmark [FRAMES]\n"
+                  << "       " << argv[0] << " --jobs-benchmark [TASKS]\n"
+                  << "       " << argv[0] << " --dispatch-benchmark [CALLS]\n"
+                  << "       " << argv[0] << " --resize-test" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Per slot particle buffers moved by the compute queue while graphics draws,
+// to give VULKANCTX_ASYNC_COMPUTE something to overlap
+struct ParticleWorkload {
+    vulkanctx::ComputePipeline pipeline;
+    vulkanctx::UniqueDescriptorPool descriptorPool;
+    std::vector<vulkanctx::Buffer> buffers;
+    std::vector<VkDescriptorSet> descriptorSets;
+    uint32_t count;
+
+    // Slots whose buffer holds particles already
+    std::vector<bool> seeded;
+};
+
+struct ParticleParameters {
+    uint32_t count;
+    uint32_t seed;
+    float attractor[2];
+};
+
+// What the simulation thread advances: the attractor of the particles,
+// circling the origin
+struct SceneState {
+    double angle;
+};
+
+auto stepScene(SceneState &state, const double &dt) -> void {
+    state.angle += 0.5 * dt;
+}
+
+auto blendScene(const SceneState &from,
+                const SceneState &to,
+                const double &alpha) -> SceneState {
+    return {from.angle + (to.angle - from.angle) * alpha};
+}
+
+// VULKANCTX_SIMULATION_RATE is how many steps per second the scene takes,
+// independent of the frame rate
+auto simulationRate() -> double {
+    const char *value = std::getenv("VULKANCTX_SIMULATION_RATE");
+    const double rate = value != nullptr ? std::strtod(value, nullptr) : 0.0;
+
+    return rate > 0.0 ? rate : 60.0;
+}
+
+auto createParticleWorkload(const VkDevice &device,
+                            const VkPhysicalDevice &physicalDevice,
+                            const uint32_t &slotCount,
+                            const uint32_t &count) -> ParticleWorkload {
+    ParticleWorkload workload;
+    workload.count = count;
+    workload.seeded.assign(slotCount, false);
+    workload.pipeline = vulkanctx::createComputePipeline(
+        device,
+        vulkanctx::readShaderFile("shaders/particles.comp.spv"),
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER},
+        sizeof(ParticleParameters));
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = slotCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = slotCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    VkDescriptorPool descriptorPool;
+    if (vulkanctx::vkCreateDescriptorPool(device,
+                                          &poolInfo,
+                                          vulkanctx::hostAllocator(),
+                                          &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool");
+    }
+
+    workload.descriptorPool =
+        vulkanctx::UniqueDescriptorPool(device, descriptorPool);
+
+    std::vector<VkDescriptorSetLayout> layouts(
+        slotCount, workload.pipeline.descriptorSetLayout);
+    workload.descriptorSets.resize(slotCount);
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = slotCount;
+    setInfo.pSetLayouts = layouts.data();
+
+    if (vulkanctx::vkAllocateDescriptorSets(
+            device, &setInfo, workload.descriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets");
+    }
+
+    for (uint32_t slot = 0; slot < slotCount; slot++) {
+        workload.buffers.push_back(vulkanctx::createBuffer(
+            device,
+            physicalDevice,
+            count * 4 * sizeof(float),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0}));
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = workload.buffers.back().handle;
+        bufferInfo.offset = 0;
+        bufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = workload.descriptorSets[slot];
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &bufferInfo;
+
+        vulkanctx::vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    return workload;
 }
 
 } // namespace app
 
-int main() {
+int main(int argc, char **argv) {
+    // Constructed first so that every phase is measured from launch
+    vulkanctx::StartupProfiler profiler;
+
     try {
-        auto windowPtr = app::initializeWindow(WIDTH, HEIGHT, APP_NAME);
-
-        auto instance = vulkanctx::createInstance(APP_NAME);
-        auto debugMessenger = vulkanctx::setupDebugMessenger(instance);
-        auto surface = vulkanctx::createSurface(instance, windowPtr);
-        auto physicalDevice = vulkanctx::pickPhysicalDevice(instance, surface);
-        auto device = vulkanctx::createLogicalDevice(physicalDevice, surface);
-
-        auto graphicsQueue =
-            vulkanctx::getGraphicsQueue(device, physicalDevice, surface);
-        auto presentQueue =
-            vulkanctx::getPresentQueue(device, physicalDevice, surface);
-
-        auto swapChain = vulkanctx::createSwapChain(
-            device, physicalDevice, surface, windowPtr);
-        auto swapChainImages = vulkanctx::retriveSwapChainImages(
-            device, swapChain.handle, swapChain.count);
-        auto swapChainImageViews = vulkanctx::createImageViews(
-            device, swapChainImages, swapChain.format);
-
-        auto renderPass = vulkanctx::createRenderPass(device, swapChain.format);
-        auto graphicsPipeline = vulkanctx::createGraphicsPipeline(
-            device, renderPass, swapChain.extent);
-        auto framebuffers = vulkanctx::createFramebuffers(
-            device, renderPass, swapChainImageViews, swapChain.extent);
-
-        auto commandPool =
-            vulkanctx::createCommandPool(device, physicalDevice, surface);
-        auto commandBuffers =
-            vulkanctx::createCommandBuffers(device,
-                                            swapChain.extent,
-                                            renderPass,
-                                            graphicsPipeline.handle,
-                                            commandPool,
-                                            framebuffers);
-
-        auto synchronizationObject = vulkanctx::createSynchronizationObject(
-            device, MAX_FRAMES_IN_FLIGHT, swapChainImages.size());
-
-        size_t currentFrame = 0;
-
-        while (!glfwWindowShouldClose(windowPtr)) {
-            glfwPollEvents();
-
-            vulkanctx::drawFrame(device,
-                                 swapChain,
-                                 commandBuffers,
-                                 graphicsQueue,
-                                 presentQueue,
-                                 synchronizationObject,
-                                 currentFrame);
-
-            currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        using Affinity = vulkanctx::StartupGraph::Affinity;
+
+        vulkanctx::reportDiagnostics(std::cout);
+
+        // Lets the pooled host allocator be compared against the driver's
+        const char *allocator = std::getenv("VULKANCTX_HOST_ALLOCATOR");
+        if (allocator != nullptr && strcmp(allocator, "system") == 0) {
+            vulkanctx::setHostAllocator(nullptr);
         }
 
-        vkDeviceWaitIdle(device);
-
-        vulkanctx::cleanup(instance,
-                           device,
-                           surface,
-                           swapChain.handle,
-                           swapChainImageViews,
-                           renderPass,
-                           graphicsPipeline.layout,
-                           graphicsPipeline.handle,
-                           framebuffers,
-                           commandPool,
-                           synchronizationObject,
-                           debugMessenger);
-        app::cleanup(windowPtr);
+        // The one mode that needs the windows, see ResizeTest
+        const bool resizeTestMode =
+            argc > 1 && strcmp(argv[1], "--resize-test") == 0;
+
+        if (argc > 1 && !resizeTestMode) {
+            const int result = app::runHeadlessMode(argc, argv);
+            vulkanctx::objectTracker().reportLeaks(std::cerr);
+
+            return result;
+        }
+
+        const size_t windowCount = app::windowCount();
+
+        // Everything kept per frame in flight is made for the most frames
+        // there may ever be, the synchronization is sized on demand
+        const app::FramesInFlight framesInFlight = app::framesInFlight();
+        const uint32_t slotCount = framesInFlight.count;
+        const uint32_t initialDepth =
+            framesInFlight.adaptive ? std::min(slotCount, 2u) : slotCount;
+
+        std::vector<GLFWwindow *> windows;
+        bool resizeTestPassed = true;
+
+        // Scoped so that every Vulkan object is gone before the window. The
+        // owners are destroyed in reverse order of declaration, which is also
+        // the order Vulkan needs.
+        {
+            vulkanctx::UniqueInstance instance;
+            vulkanctx::UniqueDebugMessenger debugMessenger;
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+            vulkanctx::UniqueDevice device;
+            VkQueue graphicsQueue = VK_NULL_HANDLE;
+            VkQueue presentQueue = VK_NULL_HANDLE;
+            vulkanctx::UniqueCommandPool commandPool;
+            std::vector<vulkanctx::PresentTarget> targets(windowCount);
+            vulkanctx::DeletionQueue deletionQueue;
+            std::optional<vulkanctx::SynchronizationObject>
+                synchronizationObject;
+            std::optional<vulkanctx::VideoWriter> videoWriter;
+            std::optional<vulkanctx::FrameReadback> readback;
+            std::optional<app::ParticleWorkload> particles;
+            std::optional<vulkanctx::FixedStepSimulation<app::SceneState>>
+                simulation;
+            app::SceneState scene{};
+            std::optional<vulkanctx::AsyncCompute> compute;
+            std::optional<vulkanctx::FrameDepthController> frameDepth;
+            std::vector<char> vertexShaderCode;
+            std::vector<char> fragmentShaderCode;
+
+            // Phases touching GLFW or the surface stay on the main thread, the
+            // rest is free to overlap with the swap chain chain of work
+            vulkanctx::StartupGraph graph;
+
+            auto shaders =
+                graph.addPhase("load shaders", {}, Affinity::Worker, [&] {
+                    vertexShaderCode =
+                        vulkanctx::readShaderFile("shaders/shader.vert.spv");
+                    fragmentShaderCode =
+                        vulkanctx::readShaderFile("shaders/shader.frag.spv");
+                });
+
+            auto window = graph.addPhase("window", {}, Affinity::Main, [&] {
+                windows = app::initializeWindows(
+                    windowCount, WIDTH, HEIGHT, APP_NAME);
+            });
+
+            auto instancePhase =
+                graph.addPhase("instance", {window}, Affinity::Main, [&] {
+                    instance = vulkanctx::createInstance(APP_NAME);
+                    debugMessenger = vulkanctx::setupDebugMessenger(instance);
+                });
+
+            auto surfacePhase = graph.addPhase(
+                "surface", {instancePhase}, Affinity::Main, [&] {
+                    for (size_t i = 0; i < windowCount; i++) {
+                        targets[i].surface =
+                            vulkanctx::createSurface(instance, windows[i]);
+                    }
+                });
+
+            auto devicePhase =
+                graph.addPhase("device", {surfacePhase}, Affinity::Main, [&] {
+                    const VkSurfaceKHR surface = targets.front().surface;
+
+                    physicalDevice =
+                        vulkanctx::pickPhysicalDevice(instance, surface);
+                    device =
+                        vulkanctx::createLogicalDevice(physicalDevice, surface);
+                    vulkanctx::reportDeviceFeatures(std::cout);
+
+                    graphicsQueue = vulkanctx::getGraphicsQueue(
+                        device, physicalDevice, surface);
+                    presentQueue = vulkanctx::getPresentQueue(
+                        device, physicalDevice, surface);
+
+                    // All windows are presented at once, on the one queue
+                    for (size_t i = 1; i < windowCount; i++) {
+                        if (!vulkanctx::sharesPresentQueue(
+                                physicalDevice, surface, targets[i].surface)) {
+                            throw std::runtime_error(
+                                "Windows can't share a present queue");
+                        }
+                    }
+                });
+
+            graph.addPhase(
+                "command pool", {devicePhase}, Affinity::Worker, [&] {
+                    commandPool = vulkanctx::createCommandPool(
+                        device, physicalDevice, targets.front().surface);
+                });
+
+            graph.addPhase(
+                "sync objects", {devicePhase}, Affinity::Worker, [&] {
+                    synchronizationObject.emplace(
+                        vulkanctx::createSynchronizationObject(
+                            device, initialDepth));
+                });
+
+            // The phases of different windows only share the device and the
+            // shaders, so windows are built and recorded side by side
+            for (size_t i = 0; i < windowCount; i++) {
+                const std::string suffix =
+                    windowCount > 1 ? " " + std::to_string(i) : "";
+
+                auto windowObjectsPhase = graph.addPhase(
+                    "window objects" + suffix,
+                    {devicePhase},
+                    Affinity::Worker,
+                    [&, i] {
+                        targets[i].commandPool = vulkanctx::createCommandPool(
+                            device, physicalDevice, targets[i].surface);
+                        targets[i].imageAvailableSemaphores =
+                            vulkanctx::createSemaphores(
+                                device,
+                                initialDepth,
+                                "image available semaphore");
+                    });
+
+                auto swapChainPhase = graph.addPhase(
+                    "swap chain" + suffix,
+                    {devicePhase},
+                    Affinity::Main,
+                    [&, i] {
+                        vulkanctx::SwapChainResources &resources =
+                            targets[i].resources;
+
+                        int width, height;
+                        glfwGetFramebufferSize(windows[i], &width, &height);
+
+                        resources.swapChain = vulkanctx::createSwapChain(
+                            device,
+                            physicalDevice,
+                            targets[i].surface,
+                            {static_cast<uint32_t>(width),
+                             static_cast<uint32_t>(height)});
+                        resources.images = vulkanctx::retriveSwapChainImages(
+                            device,
+                            resources.swapChain.handle,
+                            resources.swapChain.count);
+                        targets[i].imagesInFlight.assign(
+                            resources.images.size(), VK_NULL_HANDLE);
+                    });
+
+                auto imageViewsPhase = graph.addPhase(
+                    "image views" + suffix,
+                    {swapChainPhase},
+                    Affinity::Main,
+                    [&, i] {
+                        vulkanctx::SwapChainResources &resources =
+                            targets[i].resources;
+
+                        resources.imageViews = vulkanctx::createImageViews(
+                            device,
+                            resources.images,
+                            resources.swapChain.format);
+                    });
+
+                auto renderPassPhase = graph.addPhase(
+                    "render pass" + suffix,
+                    {swapChainPhase},
+                    Affinity::Worker,
+                    [&, i] {
+                        vulkanctx::SwapChainResources &resources =
+                            targets[i].resources;
+
+                        resources.renderPass = vulkanctx::createRenderPass(
+                            device, resources.swapChain.format);
+                    });
+
+                auto pipelinePhase = graph.addPhase(
+                    "pipeline" + suffix,
+                    {renderPassPhase, shaders},
+                    Affinity::Worker,
+                    [&, i] {
+                        vulkanctx::SwapChainResources &resources =
+                            targets[i].resources;
+
+                        resources.graphicsPipeline =
+                            vulkanctx::createGraphicsPipeline(
+                                device,
+                                resources.renderPass,
+                                resources.swapChain.extent,
+                                vertexShaderCode,
+                                fragmentShaderCode);
+                    });
+
+                auto framebuffersPhase = graph.addPhase(
+                    "framebuffers" + suffix,
+                    {imageViewsPhase, renderPassPhase},
+                    Affinity::Main,
+                    [&, i] {
+                        vulkanctx::SwapChainResources &resources =
+                            targets[i].resources;
+
+                        resources.framebuffers = vulkanctx::createFramebuffers(
+                            device,
+                            resources.renderPass,
+                            resources.imageViews,
+                            resources.swapChain.extent);
+                    });
+
+                // Recorded from the window's own pool, which no other phase
+                // touches
+                graph.addPhase(
+                    "command buffers" + suffix,
+                    {framebuffersPhase, pipelinePhase, windowObjectsPhase},
+                    Affinity::Worker,
+                    [&, i] {
+                        vulkanctx::SwapChainResources &resources =
+                            targets[i].resources;
+
+                        resources.commandBuffers =
+                            vulkanctx::createCommandBuffers(
+                                device,
+                                resources.swapChain.extent,
+                                resources.renderPass,
+                                resources.graphicsPipeline.handle,
+                                targets[i].commandPool,
+                                resources.framebuffers);
+                    });
+            }
+
+            graph.run(profiler);
+
+            // Copies every frame of the first window back to host memory, for
+            // encoding and for checking what was rendered. VULKANCTX_VIDEO
+            // streams the frames converted to I420 as Y4M, or as raw NV12 if
+            // VULKANCTX_VIDEO_FORMAT=nv12.
+            uint64_t readbackBytes = 0;
+            const char *videoPath = std::getenv("VULKANCTX_VIDEO");
+
+            if (videoPath != nullptr) {
+                const char *videoFormat =
+                    std::getenv("VULKANCTX_VIDEO_FORMAT");
+                bool nv12 =
+                    videoFormat != nullptr && strcmp(videoFormat, "nv12") == 0;
+
+                videoWriter.emplace(videoPath, 60);
+                readback.emplace(
+                    device,
+                    physicalDevice,
+                    commandPool,
+                    slotCount,
+                    [&](const vulkanctx::ReadbackFrame &frame) {
+                        readbackBytes += frame.size;
+                        videoWriter->write(frame);
+                    },
+                    nv12 ? vulkanctx::ReadbackFormat::NV12
+                         : vulkanctx::ReadbackFormat::I420);
+            } else if (std::getenv("VULKANCTX_READBACK") != nullptr) {
+                readback.emplace(
+                    device,
+                    physicalDevice,
+                    commandPool,
+                    slotCount,
+                    [&](const vulkanctx::ReadbackFrame &frame) {
+                        readbackBytes += frame.size;
+                    });
+            }
+
+            if (readback) {
+                readback->prepare(targets.front().resources,
+                                  deletionQueue,
+                                  synchronizationObject->submittedFrame);
+            }
+
+            // Runs a particle simulation on the compute queue next to the
+            // rendering and reports how much of it the graphics work hid
+            if (std::getenv("VULKANCTX_ASYNC_COMPUTE") != nullptr) {
+                particles.emplace(app::createParticleWorkload(
+                    device, physicalDevice, slotCount, 1 << 18));
+                simulation.emplace(scene,
+                                   app::simulationRate(),
+                                   app::stepScene,
+                                   app::blendScene);
+
+                compute.emplace(
+                    device,
+                    physicalDevice,
+                    targets.front().surface,
+                    slotCount,
+                    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT,
+                    [&](const VkCommandBuffer &commandBuffer,
+                        const uint32_t &slot,
+                        const uint64_t &) {
+                        const float angle = static_cast<float>(scene.angle);
+
+                        // Each slot is seeded by the first frame using it
+                        app::ParticleParameters parameters{
+                            particles->count,
+                            particles->seeded[slot] ? 0u : 1u,
+                            {0.25f * std::cos(angle), 0.25f * std::sin(angle)}};
+                        particles->seeded[slot] = true;
+
+                        vulkanctx::recordDispatch(
+                            commandBuffer,
+                            particles->pipeline,
+                            particles->descriptorSets[slot],
+                            &parameters,
+                            {vulkanctx::groupCount(particles->count, 64),
+                             1,
+                             1});
+                    });
+
+                for (uint32_t slot = 0; slot < slotCount; slot++) {
+                    compute->shareBuffer(slot,
+                                         particles->buffers[slot].handle);
+                }
+            }
+
+            if (framesInFlight.adaptive) {
+                frameDepth.emplace(device,
+                                   physicalDevice,
+                                   targets.front().surface,
+                                   slotCount);
+            }
+
+            // Frames acquire late and, with present wait, are started only
+            // once the previous one is on screen
+            if (std::getenv("VULKANCTX_LOW_LATENCY") != nullptr) {
+                synchronizationObject->lowLatency = true;
+
+                if (frameDepth) {
+                    frameDepth->setLatencySensitive(true);
+                }
+
+                std::cout << "Low latency mode"
+                          << (vulkanctx::enabledDeviceFeatures().presentWait
+                                  ? ", waiting for presents"
+                                  : ", late acquire only")
+                          << std::endl;
+            }
+
+            std::optional<app::ResizeTest> resizeTest;
+
+            if (resizeTestMode) {
+                const double refreshRate = app::refreshRate();
+
+                resizeTest.emplace(windows.front(),
+                                   refreshRate > 0.0 ? refreshRate : 60.0);
+            }
+
+            // The command buffers are recorded once, so only the window
+            // system can change what is on screen. Readback and compute want
+            // every frame, as do VULKANCTX_CONTINUOUS for measuring and the
+            // resize test.
+            vulkanctx::RedrawScheduler scheduler(std::chrono::seconds(1));
+            scheduler.setContinuous(
+                readback || compute || resizeTest ||
+                std::getenv("VULKANCTX_CONTINUOUS") != nullptr);
+
+            // Asks GLFW, so it has to happen before the render thread starts
+            std::optional<vulkanctx::FrameLimiter> limiter;
+            const double targetFrameRate = app::targetFrameRate();
+
+            if (targetFrameRate > 0.0) {
+                limiter.emplace(targetFrameRate);
+            }
+
+            // From here on the main thread only pumps events, everything
+            // below runs on the render thread until the window closes
+            vulkanctx::RenderThread renderThread(windows, scheduler);
+
+            // Resizes the window from the thread that owns it
+            if (resizeTest) {
+                renderThread.setTick([&] { resizeTest->tick(); },
+                                     std::chrono::milliseconds(10));
+            }
+
+            renderThread.run([&] {
+                size_t currentFrame = 0;
+                bool firstFrame = true;
+                std::vector<bool> iconified(windowCount, false);
+                std::vector<VkExtent2D> framebufferSizes(windowCount);
+                auto loopStart = vulkanctx::StartupClock::now();
+
+                while (!renderThread.stopRequested()) {
+                    if (synchronizationObject->lowLatency) {
+                        vulkanctx::waitForPresents(device, targets);
+                    }
+
+                    // Nothing reacts to input yet, only the windows matter
+                    while (auto event = renderThread.pollEvent()) {
+                        using Type = vulkanctx::WindowEvent::Type;
+
+                        if (event->type == Type::FramebufferResize) {
+                            targets[event->window].stale = true;
+                        } else if (event->type == Type::Iconify) {
+                            iconified[event->window] = true;
+                        } else if (event->type == Type::Restore) {
+                            iconified[event->window] = false;
+                        }
+                    }
+
+                    // Minimized windows sit frames out while the others are
+                    // still drawn. Without any window left to draw, only an
+                    // event like a restore or a resize can change that, so
+                    // the loop sleeps until one arrives, continuous or not.
+                    bool anyDrawn = false;
+
+                    for (size_t i = 0; i < windowCount; i++) {
+                        framebufferSizes[i] = renderThread.framebufferSize(i);
+                        targets[i].paused = iconified[i] ||
+                                            framebufferSizes[i].width == 0 ||
+                                            framebufferSizes[i].height == 0;
+                        anyDrawn = anyDrawn || !targets[i].paused;
+                    }
+
+                    if (!anyDrawn) {
+                        scheduler.waitForEvent();
+                        continue;
+                    }
+
+                    if (!scheduler.waitForFrame()) {
+                        continue;
+                    }
+
+                    if (limiter) {
+                        limiter->wait();
+                    }
+
+                    // A frame that reacts to input would sample it here
+                    const auto inputTime = vulkanctx::FramePacing::Clock::now();
+
+                    // Whatever the simulation reached by now, never waiting
+                    // for its next step
+                    if (simulation) {
+                        scene = simulation->sample(inputTime);
+                    }
+
+                    for (size_t i = 0; i < windowCount; i++) {
+                        vulkanctx::PresentTarget &target = targets[i];
+
+                        if (target.paused || !target.stale) {
+                            continue;
+                        }
+
+                        vulkanctx::recreateSwapChain(
+                            device,
+                            physicalDevice,
+                            framebufferSizes[i],
+                            target,
+                            *synchronizationObject,
+                            deletionQueue);
+
+                        if (resizeTest && i == 0) {
+                            resizeTest->recreated();
+                        }
+
+                        if (readback && i == 0) {
+                            readback->prepare(
+                                target.resources,
+                                deletionQueue,
+                                synchronizationObject->submittedFrame);
+                        }
+                    }
+
+                    vulkanctx::drawFrame(device,
+                                         targets,
+                                         graphicsQueue,
+                                         presentQueue,
+                                         *synchronizationObject,
+                                         currentFrame,
+                                         inputTime,
+                                         readback ? &*readback : nullptr,
+                                         compute ? &*compute : nullptr,
+                                         frameDepth ? &*frameDepth : nullptr);
+
+                    if (resizeTest) {
+                        resizeTest->frame(synchronizationObject->waits);
+                    }
+
+                    using Status = vulkanctx::FrameStatus;
+
+                    // Recreated before the next frame, which is drawn right
+                    // away as this one may not have been shown
+                    for (auto &target : targets) {
+                        if (!target.paused &&
+                            target.status != Status::Presented) {
+                            target.stale = true;
+                            scheduler.markDirty();
+                        }
+                    }
+
+                    // Frees whatever a swap chain recreation left behind once
+                    // the frames that used it are done
+                    deletionQueue.collect(synchronizationObject->retiredFrame);
+
+                    if (firstFrame) {
+                        profiler.record("first frame",
+                                        loopStart,
+                                        vulkanctx::StartupClock::now());
+                        profiler.report(std::cout);
+                        firstFrame = false;
+
+                        if (vulkanctx::hostAllocator() != nullptr) {
+                            vulkanctx::defaultHostAllocator().report(
+                                std::cout);
+                        }
+                    }
+
+                    currentFrame =
+                        (currentFrame + 1) % synchronizationObject->amount;
+
+                    // The depth only changes as the slots wrap around
+                    if (frameDepth && currentFrame == 0 &&
+                        frameDepth->depth() != synchronizationObject->amount) {
+                        vulkanctx::resizeFramesInFlight(
+                            device,
+                            presentQueue,
+                            targets,
+                            *synchronizationObject,
+                            frameDepth->depth(),
+                            deletionQueue,
+                            readback ? &*readback : nullptr,
+                            compute ? &*compute : nullptr,
+                            &*frameDepth);
+                    }
+                }
+            });
+
+            // Only needed once, before everything goes out of scope
+            vulkanctx::vkDeviceWaitIdle(device);
+
+            scheduler.report(std::cout);
+
+            if (limiter) {
+                limiter->report(std::cout);
+            }
+
+            if (simulation) {
+                simulation->report(std::cout);
+            }
+
+            for (size_t i = 0; i < windowCount; i++) {
+                targets[i].pacing.report(std::cout,
+                                         "Window " + std::to_string(i));
+            }
+
+            if (renderThread.eventsDropped() > 0) {
+                std::cout << "Dropped " << renderThread.eventsDropped()
+                          << " window events" << std::endl;
+            }
+
+            if (frameDepth) {
+                frameDepth->report(std::cout);
+            }
+
+            if (resizeTest) {
+                resizeTestPassed = resizeTest->report(std::cout);
+            }
+
+            if (readback) {
+                // The device is idle, so the last frames can be taken too
+                for (uint32_t slot = 0; slot < slotCount; slot++) {
+                    readback->collect(slot);
+                }
+
+                std::cout << "Read back " << readback->framesRead()
+                          << " frames (" << readbackBytes / (1024 * 1024)
+                          << " MiB), dropped " << readback->framesDropped()
+                          << std::endl;
+            }
+
+            if (compute) {
+                for (uint32_t slot = 0; slot < slotCount; slot++) {
+                    compute->collect(slot);
+                }
+
+                compute->report(std::cout);
+            }
+
+            if (videoWriter) {
+                videoWriter->finish();
+                std::cout << "Wrote " << videoWriter->framesWritten()
+                          << " video frames ("
+                          << videoWriter->bytesWritten() / (1024 * 1024)
+                          << " MiB) to " << videoPath << std::endl;
+            }
+        }
+
+        app::cleanup(windows);
+
+        if (!resizeTestPassed) {
+            return EXIT_FAILURE;
+        }
 
     } catch (const std::exception &e) {
         std::cerr << e.what() << std::endl;
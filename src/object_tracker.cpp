@@ -0,0 +1,155 @@
+#include <algorithm>
+
+#include "diagnostics.h"
+#include "object_tracker.h"
+
+auto vulkanctx::objectTypeName(const VkObjectType &type) -> const char * {
+    switch (type) {
+    case VK_OBJECT_TYPE_INSTANCE:
+        return "instance";
+    case VK_OBJECT_TYPE_DEVICE:
+        return "device";
+    case VK_OBJECT_TYPE_QUEUE:
+        return "queue";
+    case VK_OBJECT_TYPE_SEMAPHORE:
+        return "semaphore";
+    case VK_OBJECT_TYPE_COMMAND_BUFFER:
+        return "command buffer";
+    case VK_OBJECT_TYPE_FENCE:
+        return "fence";
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+        return "device memory";
+    case VK_OBJECT_TYPE_BUFFER:
+        return "buffer";
+    case VK_OBJECT_TYPE_IMAGE:
+        return "image";
+    case VK_OBJECT_TYPE_QUERY_POOL:
+        return "query pool";
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        return "image view";
+    case VK_OBJECT_TYPE_SHADER_MODULE:
+        return "shader module";
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        return "pipeline layout";
+    case VK_OBJECT_TYPE_RENDER_PASS:
+        return "render pass";
+    case VK_OBJECT_TYPE_PIPELINE:
+        return "pipeline";
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+        return "descriptor set layout";
+    case VK_OBJECT_TYPE_SAMPLER:
+        return "sampler";
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        return "descriptor pool";
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+        return "framebuffer";
+    case VK_OBJECT_TYPE_COMMAND_POOL:
+        return "command pool";
+    case VK_OBJECT_TYPE_SURFACE_KHR:
+        return "surface";
+    case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+        return "swap chain";
+    case VK_OBJECT_TYPE_DEBUG_UTILS_MESSENGER_EXT:
+        return "debug messenger";
+    default:
+        return "other";
+    }
+}
+
+auto vulkanctx::ObjectTracker::created(const VkObjectType &type,
+                                       const uint64_t &handle,
+                                       const char *file,
+                                       const int &line) -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ObjectCounts &counts = counts_[type];
+    counts.created++;
+    counts.live++;
+    counts.peak = std::max(counts.peak, counts.live);
+
+    if (diagnosticsCompiledIn) {
+        sites_.emplace(std::make_pair(type, handle), Site{file, line});
+    }
+}
+
+auto vulkanctx::ObjectTracker::destroyed(const VkObjectType &type,
+                                         const uint64_t &handle) -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ObjectCounts &counts = counts_[type];
+    counts.destroyed++;
+
+    // Destroying what was never counted would otherwise wrap around
+    if (counts.live > 0) {
+        counts.live--;
+    }
+
+    if (diagnosticsCompiledIn) {
+        auto site = sites_.find(std::make_pair(type, handle));
+
+        if (site != sites_.end()) {
+            sites_.erase(site);
+        }
+    }
+}
+
+auto vulkanctx::ObjectTracker::counts(const VkObjectType &type) const
+    -> ObjectCounts {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto counts = counts_.find(type);
+    return counts != counts_.end() ? counts->second : ObjectCounts{};
+}
+
+auto vulkanctx::ObjectTracker::live() const -> uint64_t {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t live = 0;
+
+    for (const auto &[type, counts] : counts_) {
+        live += counts.live;
+    }
+
+    return live;
+}
+
+auto vulkanctx::ObjectTracker::report(std::ostream &stream) const -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    stream << "Vulkan objects (live/peak/created):" << std::endl;
+
+    for (const auto &[type, counts] : counts_) {
+        stream << "  " << objectTypeName(type) << ": " << counts.live << "/"
+               << counts.peak << "/" << counts.created << std::endl;
+    }
+}
+
+auto vulkanctx::ObjectTracker::reportLeaks(std::ostream &stream) const
+    -> uint64_t {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t leaked = 0;
+
+    for (const auto &[type, counts] : counts_) {
+        if (counts.live == 0) {
+            continue;
+        }
+
+        leaked += counts.live;
+        stream << "Leaked " << counts.live << " " << objectTypeName(type)
+               << (counts.live > 1 ? " objects" : " object") << std::endl;
+    }
+
+    for (const auto &[object, site] : sites_) {
+        stream << "  " << objectTypeName(object.first) << " 0x" << std::hex
+               << object.second << std::dec << " created at " << site.file
+               << ":" << site.line << std::endl;
+    }
+
+    return leaked;
+}
+
+auto vulkanctx::objectTracker() -> ObjectTracker & {
+    static ObjectTracker tracker;
+    return tracker;
+}
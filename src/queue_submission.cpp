@@ -0,0 +1,192 @@
+#include "device_dispatch.h"
+#include "device_features.h"
+#include "queue_submission.h"
+
+auto vulkanctx::SubmissionBuilder::Batch::operator==(const Batch &other) const
+    -> bool {
+    return firstWait == other.firstWait &&
+           firstCommandBuffer == other.firstCommandBuffer &&
+           firstSignal == other.firstSignal;
+}
+
+vulkanctx::SubmissionBuilder::SubmissionBuilder() : batches_{Batch{0, 0, 0}} {}
+
+auto vulkanctx::SubmissionBuilder::wait(const VkSemaphore &semaphore,
+                                        const VkPipelineStageFlags2 &stageMask,
+                                        const uint64_t &value) -> void {
+    VkSemaphoreSubmitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    waitInfo.semaphore = semaphore;
+    waitInfo.value = value;
+    waitInfo.stageMask = stageMask;
+
+    waits_.push_back(waitInfo);
+}
+
+auto vulkanctx::SubmissionBuilder::add(const VkCommandBuffer &commandBuffer)
+    -> void {
+    VkCommandBufferSubmitInfo commandBufferInfo{};
+    commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    commandBufferInfo.commandBuffer = commandBuffer;
+
+    commandBuffers_.push_back(commandBufferInfo);
+}
+
+auto vulkanctx::SubmissionBuilder::signal(
+    const VkSemaphore &semaphore,
+    const VkPipelineStageFlags2 &stageMask,
+    const uint64_t &value) -> void {
+    VkSemaphoreSubmitInfo signalInfo{};
+    signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signalInfo.semaphore = semaphore;
+    signalInfo.value = value;
+    signalInfo.stageMask = stageMask;
+
+    signals_.push_back(signalInfo);
+}
+
+auto vulkanctx::SubmissionBuilder::batchEnd(const size_t &index) const
+    -> Batch {
+    if (index + 1 < batches_.size()) {
+        return batches_[index + 1];
+    }
+
+    return Batch{waits_.size(), commandBuffers_.size(), signals_.size()};
+}
+
+auto vulkanctx::SubmissionBuilder::batchCount() const -> size_t {
+    // Only the last batch can be empty, nextBatch doesn't close empty ones
+    const size_t last = batches_.size() - 1;
+    return batchEnd(last) == batches_[last] ? last : batches_.size();
+}
+
+auto vulkanctx::SubmissionBuilder::nextBatch() -> void {
+    if (batchCount() == batches_.size()) {
+        batches_.push_back(batchEnd(batches_.size() - 1));
+    }
+}
+
+auto vulkanctx::SubmissionBuilder::empty() const -> bool {
+    return batchCount() == 0;
+}
+
+auto vulkanctx::SubmissionBuilder::flush(const VkQueue &queue,
+                                         const VkFence &fence) -> VkResult {
+    VkResult result;
+
+    if (enabledDeviceFeatures().synchronization2) {
+        submits_.clear();
+
+        for (size_t i = 0; i < batchCount(); i++) {
+            const Batch &begin = batches_[i];
+            const Batch end = batchEnd(i);
+
+            VkSubmitInfo2 submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+            submitInfo.waitSemaphoreInfoCount =
+                static_cast<uint32_t>(end.firstWait - begin.firstWait);
+            submitInfo.pWaitSemaphoreInfos = waits_.data() + begin.firstWait;
+            submitInfo.commandBufferInfoCount = static_cast<uint32_t>(
+                end.firstCommandBuffer - begin.firstCommandBuffer);
+            submitInfo.pCommandBufferInfos =
+                commandBuffers_.data() + begin.firstCommandBuffer;
+            submitInfo.signalSemaphoreInfoCount =
+                static_cast<uint32_t>(end.firstSignal - begin.firstSignal);
+            submitInfo.pSignalSemaphoreInfos =
+                signals_.data() + begin.firstSignal;
+
+            submits_.push_back(submitInfo);
+        }
+
+        result = vkQueueSubmit2(queue,
+                                static_cast<uint32_t>(submits_.size()),
+                                submits_.data(),
+                                fence);
+    } else {
+        result = submitLegacy(queue, fence);
+    }
+
+    waits_.clear();
+    commandBuffers_.clear();
+    signals_.clear();
+    batches_.assign(1, Batch{0, 0, 0});
+
+    return result;
+}
+
+// Only taken on devices without synchronization2, so the arrays in the old
+// layout are simply built on every call
+auto vulkanctx::SubmissionBuilder::submitLegacy(const VkQueue &queue,
+                                                const VkFence &fence)
+    -> VkResult {
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues;
+
+    for (const auto &waitInfo : waits_) {
+        waitSemaphores.push_back(waitInfo.semaphore);
+        waitStages.push_back(
+            static_cast<VkPipelineStageFlags>(waitInfo.stageMask));
+        waitValues.push_back(waitInfo.value);
+    }
+
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    for (const auto &commandBufferInfo : commandBuffers_) {
+        commandBuffers.push_back(commandBufferInfo.commandBuffer);
+    }
+
+    // Binary semaphores are always signaled once all commands completed
+    std::vector<VkSemaphore> signalSemaphores;
+    std::vector<uint64_t> signalValues;
+
+    for (const auto &signalInfo : signals_) {
+        signalSemaphores.push_back(signalInfo.semaphore);
+        signalValues.push_back(signalInfo.value);
+    }
+
+    const size_t count = batchCount();
+    std::vector<VkTimelineSemaphoreSubmitInfo> timelineInfos(count);
+    std::vector<VkSubmitInfo> submitInfos(count);
+
+    for (size_t i = 0; i < count; i++) {
+        const Batch &begin = batches_[i];
+        const Batch end = batchEnd(i);
+
+        const auto waitCount =
+            static_cast<uint32_t>(end.firstWait - begin.firstWait);
+        const auto commandBufferCount = static_cast<uint32_t>(
+            end.firstCommandBuffer - begin.firstCommandBuffer);
+        const auto signalCount =
+            static_cast<uint32_t>(end.firstSignal - begin.firstSignal);
+
+        VkTimelineSemaphoreSubmitInfo &timelineInfo = timelineInfos[i];
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = waitCount;
+        timelineInfo.pWaitSemaphoreValues =
+            waitValues.data() + begin.firstWait;
+        timelineInfo.signalSemaphoreValueCount = signalCount;
+        timelineInfo.pSignalSemaphoreValues =
+            signalValues.data() + begin.firstSignal;
+
+        VkSubmitInfo &submitInfo = submitInfos[i];
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = waitCount;
+        submitInfo.pWaitSemaphores = waitSemaphores.data() + begin.firstWait;
+        submitInfo.pWaitDstStageMask = waitStages.data() + begin.firstWait;
+        submitInfo.commandBufferCount = commandBufferCount;
+        submitInfo.pCommandBuffers =
+            commandBuffers.data() + begin.firstCommandBuffer;
+        submitInfo.signalSemaphoreCount = signalCount;
+        submitInfo.pSignalSemaphores =
+            signalSemaphores.data() + begin.firstSignal;
+
+        // The structure is unknown to devices without timeline semaphores
+        if (enabledDeviceFeatures().timelineSemaphore) {
+            submitInfo.pNext = &timelineInfo;
+        }
+    }
+
+    return vkQueueSubmit(
+        queue, static_cast<uint32_t>(count), submitInfos.data(), fence);
+}
@@ -0,0 +1,69 @@
+#include "redraw_scheduler.h"
+
+vulkanctx::RedrawScheduler::RedrawScheduler(
+    const std::chrono::milliseconds &idleTimeout)
+    : idleTimeout_(idleTimeout) {}
+
+auto vulkanctx::RedrawScheduler::markDirty() -> void {
+    dirty_.store(true, std::memory_order_release);
+    wake();
+}
+
+auto vulkanctx::RedrawScheduler::wake() -> void {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakePending_ = true;
+    }
+
+    woken_.notify_one();
+}
+
+auto vulkanctx::RedrawScheduler::setContinuous(const bool &continuous)
+    -> void {
+    continuous_ = continuous;
+}
+
+auto vulkanctx::RedrawScheduler::continuous() const -> bool {
+    return continuous_;
+}
+
+auto vulkanctx::RedrawScheduler::waitForFrame() -> bool {
+    if (!continuous_ && !dirty_.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        woken_.wait_for(lock, idleTimeout_, [this] { return wakePending_; });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakePending_ = false;
+    }
+
+    // Whatever marks the window dirty while the frame is drawn is picked up
+    // by the next call
+    if (dirty_.exchange(false, std::memory_order_acq_rel) || continuous_) {
+        framesDrawn_++;
+        return true;
+    }
+
+    framesSkipped_++;
+    return false;
+}
+
+auto vulkanctx::RedrawScheduler::waitForEvent() -> void {
+    std::unique_lock<std::mutex> lock(mutex_);
+    woken_.wait_for(lock, idleTimeout_, [this] { return wakePending_; });
+    wakePending_ = false;
+}
+
+auto vulkanctx::RedrawScheduler::framesDrawn() const -> uint64_t {
+    return framesDrawn_;
+}
+
+auto vulkanctx::RedrawScheduler::framesSkipped() const -> uint64_t {
+    return framesSkipped_;
+}
+
+auto vulkanctx::RedrawScheduler::report(std::ostream &stream) const -> void {
+    stream << "Drew " << framesDrawn_ << " frames, skipped " << framesSkipped_
+           << (continuous_ ? " (continuous)" : " (on demand)") << std::endl;
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <utility>
+
+#include "render_thread.h"
+
+static auto packSize(const int &width, const int &height) -> uint64_t {
+    return static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32 |
+           static_cast<uint32_t>(height);
+}
+
+vulkanctx::RenderThread::RenderThread(const std::vector<GLFWwindow *> &windows,
+                                      RedrawScheduler &scheduler,
+                                      const size_t &queueCapacity)
+    : windows_(windows), scheduler_(scheduler), events_(queueCapacity),
+      framebufferSizes_(new std::atomic<uint64_t>[windows.size()]) {
+    for (size_t i = 0; i < windows_.size(); i++) {
+        GLFWwindow *window = windows_[i];
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        framebufferSizes_[i].store(packSize(width, height));
+
+        glfwSetWindowUserPointer(window, this);
+
+        glfwSetFramebufferSizeCallback(
+            window, [](GLFWwindow *window, int width, int height) {
+                WindowEvent event{WindowEvent::Type::FramebufferResize};
+                event.width = width;
+                event.height = height;
+                of(window)->push(window, event);
+            });
+
+        glfwSetWindowRefreshCallback(window, [](GLFWwindow *window) {
+            of(window)->push(window, {WindowEvent::Type::Refresh});
+        });
+
+        glfwSetWindowIconifyCallback(
+            window, [](GLFWwindow *window, int iconified) {
+                of(window)->push(window,
+                                 {iconified ? WindowEvent::Type::Iconify
+                                            : WindowEvent::Type::Restore});
+            });
+
+        glfwSetKeyCallback(
+            window,
+            [](GLFWwindow *window, int key, int, int action, int mods) {
+                WindowEvent event{WindowEvent::Type::Key};
+                event.code = key;
+                event.action = action;
+                event.mods = mods;
+                of(window)->push(window, event);
+            });
+
+        glfwSetMouseButtonCallback(
+            window,
+            [](GLFWwindow *window, int button, int action, int mods) {
+                WindowEvent event{WindowEvent::Type::MouseButton};
+                event.code = button;
+                event.action = action;
+                event.mods = mods;
+                of(window)->push(window, event);
+            });
+
+        glfwSetCursorPosCallback(
+            window, [](GLFWwindow *window, double x, double y) {
+                WindowEvent event{WindowEvent::Type::CursorMove};
+                event.x = x;
+                event.y = y;
+                of(window)->push(window, event);
+            });
+    }
+}
+
+vulkanctx::RenderThread::~RenderThread() {
+    stop();
+
+    for (GLFWwindow *window : windows_) {
+        glfwSetFramebufferSizeCallback(window, nullptr);
+        glfwSetWindowRefreshCallback(window, nullptr);
+        glfwSetWindowIconifyCallback(window, nullptr);
+        glfwSetKeyCallback(window, nullptr);
+        glfwSetMouseButtonCallback(window, nullptr);
+        glfwSetCursorPosCallback(window, nullptr);
+        glfwSetWindowUserPointer(window, nullptr);
+    }
+}
+
+auto vulkanctx::RenderThread::of(GLFWwindow *window) -> RenderThread * {
+    return static_cast<RenderThread *>(glfwGetWindowUserPointer(window));
+}
+
+auto vulkanctx::RenderThread::push(GLFWwindow *window, WindowEvent event)
+    -> void {
+    // A handful of windows at most, a search is cheaper than a map
+    event.window = static_cast<size_t>(
+        std::find(windows_.begin(), windows_.end(), window) - windows_.begin());
+
+    if (event.type == WindowEvent::Type::FramebufferResize) {
+        framebufferSizes_[event.window].store(
+            packSize(event.width, event.height), std::memory_order_release);
+    }
+
+    if (!events_.push(event)) {
+        eventsDropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    switch (event.type) {
+    case WindowEvent::Type::FramebufferResize:
+    case WindowEvent::Type::Refresh:
+    case WindowEvent::Type::Restore:
+        scheduler_.markDirty();
+        break;
+    default:
+        scheduler_.wake();
+        break;
+    }
+}
+
+auto vulkanctx::RenderThread::shouldClose() const -> bool {
+    return std::any_of(windows_.begin(), windows_.end(), [](auto *window) {
+        return glfwWindowShouldClose(window);
+    });
+}
+
+auto vulkanctx::RenderThread::setTick(
+    std::function<void()> tick, const std::chrono::milliseconds &interval)
+    -> void {
+    tick_ = std::move(tick);
+    tickInterval_ = interval;
+}
+
+auto vulkanctx::RenderThread::run(std::function<void()> loop) -> void {
+    thread_ = std::thread([this, loop = std::move(loop)] {
+        try {
+            loop();
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+
+        finished_.store(true, std::memory_order_release);
+
+        // The main thread may be blocked in glfwWaitEvents
+        glfwPostEmptyEvent();
+    });
+
+    while (!shouldClose() && !finished_.load(std::memory_order_acquire)) {
+        if (tick_) {
+            glfwWaitEventsTimeout(
+                std::chrono::duration<double>(tickInterval_).count());
+            tick_();
+        } else {
+            glfwWaitEvents();
+        }
+    }
+
+    stop();
+
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+auto vulkanctx::RenderThread::stop() -> void {
+    stopRequested_.store(true, std::memory_order_release);
+    scheduler_.wake();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+auto vulkanctx::RenderThread::stopRequested() const -> bool {
+    return stopRequested_.load(std::memory_order_acquire);
+}
+
+auto vulkanctx::RenderThread::pollEvent() -> std::optional<WindowEvent> {
+    return events_.pop();
+}
+
+auto vulkanctx::RenderThread::framebufferSize(const size_t &window) const
+    -> VkExtent2D {
+    const uint64_t size =
+        framebufferSizes_[window].load(std::memory_order_acquire);
+
+    return {static_cast<uint32_t>(size >> 32), static_cast<uint32_t>(size)};
+}
+
+auto vulkanctx::RenderThread::eventsDropped() const -> uint64_t {
+    return eventsDropped_.load(std::memory_order_relaxed);
+}
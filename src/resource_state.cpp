@@ -0,0 +1,378 @@
+#include <stdexcept>
+
+#include "device_dispatch.h"
+#include "device_features.h"
+#include "resource_state.h"
+
+// Everything that needs to be made available before others touch the memory
+constexpr VkAccessFlags2 writeAccessMask =
+    VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+    VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+    VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static auto sameDependency(const VkImageMemoryBarrier2 &a,
+                           const VkImageMemoryBarrier2 &b) -> bool {
+    return a.image == b.image &&
+           a.subresourceRange.aspectMask == b.subresourceRange.aspectMask &&
+           a.srcStageMask == b.srcStageMask &&
+           a.srcAccessMask == b.srcAccessMask &&
+           a.dstStageMask == b.dstStageMask &&
+           a.dstAccessMask == b.dstAccessMask &&
+           a.oldLayout == b.oldLayout && a.newLayout == b.newLayout;
+}
+
+auto vulkanctx::ResourceStateTracker::initialState(const ResourceUse &current)
+    -> State {
+    // As if current had been a layout transition that was waited for
+    return State{current.layout,
+                 current.stages,
+                 VK_ACCESS_2_NONE,
+                 current.stages,
+                 current.access,
+                 0};
+}
+
+auto vulkanctx::ResourceStateTracker::trackImage(
+    const VkImage &image,
+    const VkImageAspectFlags &aspectMask,
+    const uint32_t &levelCount,
+    const uint32_t &layerCount,
+    const ResourceUse &current) -> void {
+    images_[image] = Image{
+        aspectMask,
+        levelCount,
+        layerCount,
+        std::vector<State>(levelCount * layerCount, initialState(current))};
+}
+
+auto vulkanctx::ResourceStateTracker::trackBuffer(const VkBuffer &buffer,
+                                                  const ResourceUse &current)
+    -> void {
+    buffers_[buffer] = initialState(current);
+}
+
+auto vulkanctx::ResourceStateTracker::forget(const VkImage &image) -> void {
+    images_.erase(image);
+}
+
+auto vulkanctx::ResourceStateTracker::forget(const VkBuffer &buffer) -> void {
+    buffers_.erase(buffer);
+}
+
+auto vulkanctx::ResourceStateTracker::advance(State &state,
+                                              const ResourceUse &use,
+                                              const bool &hasLayout,
+                                              VkPipelineStageFlags2 &srcStages,
+                                              VkAccessFlags2 &srcAccess)
+    -> bool {
+    if (state.flush == flushes_) {
+        throw std::runtime_error(
+            "Resource used twice without flushing its barriers");
+    }
+
+    state.flush = flushes_;
+
+    const VkAccessFlags2 writes = use.access & writeAccessMask;
+    const bool transition = hasLayout && use.layout != state.layout;
+
+    if (writes == 0 && !transition) {
+        // Reads that already waited for the write, or with nothing to wait
+        // for, go ahead
+        const bool covered = state.writeStages == VK_PIPELINE_STAGE_2_NONE ||
+                             ((use.stages & ~state.readStages) == 0 &&
+                              (use.access & ~state.readAccess) == 0);
+
+        srcStages = state.writeStages;
+        srcAccess = state.writeAccess;
+
+        state.readStages |= use.stages;
+        state.readAccess |= use.access;
+
+        return !covered;
+    }
+
+    // Writes and transitions wait for the last write and the reads since,
+    // but only what was written has to be made available
+    srcStages = state.writeStages | state.readStages;
+    srcAccess = state.writeAccess;
+
+    if (hasLayout) {
+        state.layout = use.layout;
+    }
+
+    state.writeStages = use.stages;
+    state.writeAccess = writes;
+
+    // The reads of a use that only transitions are ordered after it
+    state.readStages = writes == 0 ? use.stages : VK_PIPELINE_STAGE_2_NONE;
+    state.readAccess = writes == 0 ? use.access : VK_ACCESS_2_NONE;
+
+    return transition || srcStages != VK_PIPELINE_STAGE_2_NONE;
+}
+
+auto vulkanctx::ResourceStateTracker::useImage(const VkImage &image,
+                                               const ResourceUse &use)
+    -> void {
+    auto tracked = images_.find(image);
+
+    if (tracked == images_.end()) {
+        throw std::runtime_error("Image isn't tracked");
+    }
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = tracked->second.aspectMask;
+    range.levelCount = VK_REMAINING_MIP_LEVELS;
+    range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    useImage(image, range, use);
+}
+
+auto vulkanctx::ResourceStateTracker::useImage(
+    const VkImage &image,
+    const VkImageSubresourceRange &range,
+    const ResourceUse &use) -> void {
+    auto tracked = images_.find(image);
+
+    if (tracked == images_.end()) {
+        throw std::runtime_error("Image isn't tracked");
+    }
+
+    Image &state = tracked->second;
+
+    const uint32_t levelEnd = range.levelCount == VK_REMAINING_MIP_LEVELS
+                                  ? state.levelCount
+                                  : range.baseMipLevel + range.levelCount;
+    const uint32_t layerEnd = range.layerCount == VK_REMAINING_ARRAY_LAYERS
+                                  ? state.layerCount
+                                  : range.baseArrayLayer + range.layerCount;
+
+    if (levelEnd > state.levelCount || layerEnd > state.layerCount) {
+        throw std::runtime_error("Subresource range exceeds the image");
+    }
+
+    for (uint32_t level = range.baseMipLevel; level < levelEnd; level++) {
+        for (uint32_t layer = range.baseArrayLayer; layer < layerEnd;
+             layer++) {
+            State &subresource =
+                state.subresources[level * state.layerCount + layer];
+
+            VkImageMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+            barrier.dstStageMask = use.stages;
+            barrier.dstAccessMask = use.access;
+            barrier.oldLayout = subresource.layout;
+            barrier.newLayout = use.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange = {range.aspectMask, level, 1, layer, 1};
+
+            if (advance(subresource,
+                        use,
+                        true,
+                        barrier.srcStageMask,
+                        barrier.srcAccessMask)) {
+                addImageBarrier(barrier);
+            }
+        }
+
+        mergeLevels();
+    }
+}
+
+auto vulkanctx::ResourceStateTracker::useBuffer(const VkBuffer &buffer,
+                                                const ResourceUse &use)
+    -> void {
+    auto tracked = buffers_.find(buffer);
+
+    if (tracked == buffers_.end()) {
+        throw std::runtime_error("Buffer isn't tracked");
+    }
+
+    VkBufferMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.dstStageMask = use.stages;
+    barrier.dstAccessMask = use.access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    if (advance(tracked->second,
+                use,
+                false,
+                barrier.srcStageMask,
+                barrier.srcAccessMask)) {
+        bufferBarriers_.push_back(barrier);
+    }
+}
+
+// Subresources are visited level by level and layer by layer, so a barrier
+// can grow over the next layer of its level as long as the rest matches
+auto vulkanctx::ResourceStateTracker::addImageBarrier(
+    const VkImageMemoryBarrier2 &barrier) -> void {
+    if (!imageBarriers_.empty()) {
+        VkImageMemoryBarrier2 &last = imageBarriers_.back();
+        VkImageSubresourceRange &range = last.subresourceRange;
+
+        if (sameDependency(last, barrier) && range.levelCount == 1 &&
+            range.baseMipLevel == barrier.subresourceRange.baseMipLevel &&
+            range.baseArrayLayer + range.layerCount ==
+                barrier.subresourceRange.baseArrayLayer) {
+            range.layerCount++;
+            return;
+        }
+    }
+
+    imageBarriers_.push_back(barrier);
+}
+
+// Once a level is done, its last barrier may continue one of the level
+// above with the same layers
+auto vulkanctx::ResourceStateTracker::mergeLevels() -> void {
+    if (imageBarriers_.size() < 2) {
+        return;
+    }
+
+    const VkImageMemoryBarrier2 &last = imageBarriers_.back();
+    const VkImageSubresourceRange &range = last.subresourceRange;
+
+    for (size_t i = imageBarriers_.size() - 1; i-- > 0;) {
+        VkImageMemoryBarrier2 &other = imageBarriers_[i];
+        VkImageSubresourceRange &otherRange = other.subresourceRange;
+
+        if (sameDependency(other, last) &&
+            otherRange.baseArrayLayer == range.baseArrayLayer &&
+            otherRange.layerCount == range.layerCount &&
+            otherRange.baseMipLevel + otherRange.levelCount ==
+                range.baseMipLevel) {
+            otherRange.levelCount += range.levelCount;
+            imageBarriers_.pop_back();
+            return;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------//
+//                                  Recording                                 //
+// ---------------------------------------------------------------------------//
+
+static auto legacyStages(const VkPipelineStageFlags2 &stages)
+    -> VkPipelineStageFlags {
+    auto legacy = static_cast<VkPipelineStageFlags>(stages & UINT32_MAX);
+
+    if (stages & (VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT |
+                  VK_PIPELINE_STAGE_2_RESOLVE_BIT |
+                  VK_PIPELINE_STAGE_2_CLEAR_BIT)) {
+        legacy |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+
+    return legacy;
+}
+
+static auto legacyAccess(const VkAccessFlags2 &access) -> VkAccessFlags {
+    auto legacy = static_cast<VkAccessFlags>(access & UINT32_MAX);
+
+    if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT |
+                  VK_ACCESS_2_SHADER_STORAGE_READ_BIT)) {
+        legacy |= VK_ACCESS_SHADER_READ_BIT;
+    }
+
+    if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT) {
+        legacy |= VK_ACCESS_SHADER_WRITE_BIT;
+    }
+
+    return legacy;
+}
+
+// Without synchronization2 all barriers of a call share the stage masks, so
+// those are the union of the individual ones
+static auto recordLegacyBarriers(
+    const VkCommandBuffer &commandBuffer,
+    const std::vector<VkImageMemoryBarrier2> &imageBarriers,
+    const std::vector<VkBufferMemoryBarrier2> &bufferBarriers) -> void {
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+
+    std::vector<VkImageMemoryBarrier> images;
+
+    for (const auto &barrier : imageBarriers) {
+        srcStages |= legacyStages(barrier.srcStageMask);
+        dstStages |= legacyStages(barrier.dstStageMask);
+
+        VkImageMemoryBarrier legacy{};
+        legacy.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        legacy.srcAccessMask = legacyAccess(barrier.srcAccessMask);
+        legacy.dstAccessMask = legacyAccess(barrier.dstAccessMask);
+        legacy.oldLayout = barrier.oldLayout;
+        legacy.newLayout = barrier.newLayout;
+        legacy.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+        legacy.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+        legacy.image = barrier.image;
+        legacy.subresourceRange = barrier.subresourceRange;
+
+        images.push_back(legacy);
+    }
+
+    std::vector<VkBufferMemoryBarrier> buffers;
+
+    for (const auto &barrier : bufferBarriers) {
+        srcStages |= legacyStages(barrier.srcStageMask);
+        dstStages |= legacyStages(barrier.dstStageMask);
+
+        VkBufferMemoryBarrier legacy{};
+        legacy.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        legacy.srcAccessMask = legacyAccess(barrier.srcAccessMask);
+        legacy.dstAccessMask = legacyAccess(barrier.dstAccessMask);
+        legacy.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+        legacy.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+        legacy.buffer = barrier.buffer;
+        legacy.offset = barrier.offset;
+        legacy.size = barrier.size;
+
+        buffers.push_back(legacy);
+    }
+
+    // Legacy barriers need a stage on either side
+    vulkanctx::vkCmdPipelineBarrier(
+        commandBuffer,
+        srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        dstStages != 0 ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(buffers.size()),
+        buffers.data(),
+        static_cast<uint32_t>(images.size()),
+        images.data());
+}
+
+auto vulkanctx::ResourceStateTracker::flush(
+    const VkCommandBuffer &commandBuffer) -> void {
+    flushes_++;
+
+    if (imageBarriers_.empty() && bufferBarriers_.empty()) {
+        return;
+    }
+
+    if (enabledDeviceFeatures().synchronization2) {
+        VkDependencyInfo dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependencyInfo.bufferMemoryBarrierCount =
+            static_cast<uint32_t>(bufferBarriers_.size());
+        dependencyInfo.pBufferMemoryBarriers = bufferBarriers_.data();
+        dependencyInfo.imageMemoryBarrierCount =
+            static_cast<uint32_t>(imageBarriers_.size());
+        dependencyInfo.pImageMemoryBarriers = imageBarriers_.data();
+
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    } else {
+        recordLegacyBarriers(commandBuffer, imageBarriers_, bufferBarriers_);
+    }
+
+    imageBarriers_.clear();
+    bufferBarriers_.clear();
+}
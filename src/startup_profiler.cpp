@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+#include "startup_profiler.h"
+
+// ---------------------------------------------------------------------------//
+//                                  Profiler                                  //
+// ---------------------------------------------------------------------------//
+
+vulkanctx::StartupProfiler::StartupProfiler()
+    : origin_(StartupClock::now()), mainThread_(std::this_thread::get_id()) {}
+
+auto vulkanctx::StartupProfiler::record(const std::string &name,
+                                        const StartupClock::time_point &start,
+                                        const StartupClock::time_point &end)
+    -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+    phases_.push_back({name, std::this_thread::get_id(), start, end});
+}
+
+auto vulkanctx::StartupProfiler::origin() const -> StartupClock::time_point {
+    return origin_;
+}
+
+static auto millisecondsBetween(const vulkanctx::StartupClock::time_point &from,
+                                const vulkanctx::StartupClock::time_point &to)
+    -> double {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+auto vulkanctx::StartupProfiler::report(std::ostream &stream) const -> void {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto phases = phases_;
+    std::sort(phases.begin(),
+              phases.end(),
+              [](const StartupPhase &a, const StartupPhase &b) {
+                  return a.start < b.start;
+              });
+
+    // Give worker threads short, stable names in order of first appearance
+    std::map<std::thread::id, std::string> threadNames;
+    threadNames[mainThread_] = "main";
+
+    for (const auto &phase : phases) {
+        if (threadNames.find(phase.thread) == threadNames.end()) {
+            threadNames[phase.thread] =
+                "worker " + std::to_string(threadNames.size());
+        }
+    }
+
+    StartupClock::time_point last = origin_;
+
+    const auto flags = stream.flags();
+    stream << "Startup phases (ms since launch):" << std::endl;
+    stream << std::fixed << std::setprecision(2);
+    stream << "  " << std::left << std::setw(20) << "phase" << std::right
+           << std::setw(10) << "start" << std::setw(10) << "end"
+           << std::setw(10) << "duration"
+           << "  thread" << std::endl;
+
+    for (const auto &phase : phases) {
+        stream << "  " << std::left << std::setw(20) << phase.name
+               << std::right << std::setw(10)
+               << millisecondsBetween(origin_, phase.start) << std::setw(10)
+               << millisecondsBetween(origin_, phase.end) << std::setw(10)
+               << millisecondsBetween(phase.start, phase.end) << "  "
+               << threadNames[phase.thread] << std::endl;
+
+        last = std::max(last, phase.end);
+    }
+
+    stream << "  Total: " << millisecondsBetween(origin_, last) << " ms"
+           << std::endl;
+    stream.flags(flags);
+}
+
+// ---------------------------------------------------------------------------//
+//                               Dependency graph                             //
+// ---------------------------------------------------------------------------//
+
+auto vulkanctx::StartupGraph::addPhase(const std::string &name,
+                                       const std::vector<PhaseId> &dependencies,
+                                       const Affinity &affinity,
+                                       std::function<void()> function)
+    -> PhaseId {
+    // Only allowing dependencies on earlier phases keeps the graph acyclic and
+    // lets the main thread run its phases in insertion order
+    for (const auto &dependency : dependencies) {
+        if (dependency >= nodes_.size()) {
+            throw std::runtime_error("Startup phase '" + name +
+                                     "' depends on an unknown phase");
+        }
+    }
+
+    nodes_.push_back({name, dependencies, affinity, std::move(function)});
+
+    return nodes_.size() - 1;
+}
+
+auto vulkanctx::StartupGraph::run(StartupProfiler &profiler) -> void {
+    std::vector<std::shared_future<void>> done(nodes_.size());
+    std::vector<std::promise<void>> mainPromises(nodes_.size());
+
+    auto runTimed = [&profiler](const Node &node) {
+        auto start = StartupClock::now();
+        node.function();
+        profiler.record(node.name, start, StartupClock::now());
+    };
+
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        if (nodes_[i].affinity == Affinity::Main) {
+            done[i] = mainPromises[i].get_future().share();
+        }
+    }
+
+    // Worker phases block on their dependencies inside their own thread, so
+    // launching all of them up front is enough to get maximal overlap
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        if (nodes_[i].affinity == Affinity::Worker) {
+            std::vector<std::shared_future<void>> dependencies;
+
+            for (const auto &dependency : nodes_[i].dependencies) {
+                dependencies.push_back(done[dependency]);
+            }
+
+            done[i] = std::async(std::launch::async,
+                                 [&node = nodes_[i], dependencies, runTimed] {
+                                     for (const auto &dependency :
+                                          dependencies) {
+                                         dependency.get();
+                                     }
+
+                                     runTimed(node);
+                                 })
+                          .share();
+        }
+    }
+
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        if (nodes_[i].affinity != Affinity::Main) {
+            continue;
+        }
+
+        try {
+            for (const auto &dependency : nodes_[i].dependencies) {
+                done[dependency].get();
+            }
+
+            runTimed(nodes_[i]);
+            mainPromises[i].set_value();
+        } catch (...) {
+            // Fail this and every remaining main phase so that workers
+            // waiting on them are released instead of blocking forever
+            for (size_t j = i; j < nodes_.size(); j++) {
+                if (nodes_[j].affinity == Affinity::Main) {
+                    mainPromises[j].set_exception(std::current_exception());
+                }
+            }
+
+            break;
+        }
+    }
+
+    std::exception_ptr firstError;
+
+    for (auto &phase : done) {
+        try {
+            phase.get();
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
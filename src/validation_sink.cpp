@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string_view>
+
+#include "validation_sink.h"
+
+static constexpr auto repeatReportInterval = std::chrono::seconds(1);
+
+static_assert((vulkanctx::ValidationSink::capacity &
+               (vulkanctx::ValidationSink::capacity - 1)) == 0,
+              "Validation sink capacity has to be a power of two");
+
+static auto severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+    -> const char * {
+    if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+        return "error";
+    } else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        return "warning";
+    } else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+        return "info";
+    }
+
+    return "verbose";
+}
+
+// Messages without an ID (e.g. from the loader) are deduplicated on their text
+static auto messageKey(int32_t messageId, const char *text) -> uint64_t {
+    if (messageId != 0) {
+        return static_cast<uint32_t>(messageId);
+    }
+
+    return std::hash<std::string_view>{}(std::string_view(text)) |
+           (1ULL << 63);
+}
+
+vulkanctx::ValidationSink::ValidationSink(std::ostream &stream)
+    : stream_(stream), cells_(new Cell[capacity]),
+      minimumSeverity_(VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) {
+    for (size_t i = 0; i < capacity; i++) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+vulkanctx::ValidationSink::~ValidationSink() { stop(); }
+
+auto vulkanctx::ValidationSink::start() -> void {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    worker_ = std::thread([this] {
+        auto lastReport = std::chrono::steady_clock::now();
+
+        while (running_.load(std::memory_order_acquire)) {
+            signaled_.store(false, std::memory_order_release);
+            drain();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastReport >= repeatReportInterval) {
+                reportRepeats();
+                lastReport = now;
+            }
+
+            // Repeat counts only matter once they are due, so without
+            // messages the thread sleeps until then
+            std::unique_lock<std::mutex> lock(mutex_);
+            woken_.wait_until(lock, lastReport + repeatReportInterval, [this] {
+                return signaled_.load(std::memory_order_acquire) ||
+                       !running_.load(std::memory_order_acquire);
+            });
+        }
+    });
+}
+
+auto vulkanctx::ValidationSink::stop() -> void {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+
+    woken_.notify_one();
+    worker_.join();
+
+    // Pick up whatever was enqueued while the worker was shutting down
+    drain();
+    reportRepeats();
+
+    auto dropped = dropped_.load();
+    if (dropped > 0) {
+        stream_ << "Validation layer: " << dropped
+                << " message(s) dropped because the sink was full\n";
+    }
+
+    stream_.flush();
+}
+
+auto vulkanctx::ValidationSink::enqueue(
+    VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+    VkDebugUtilsMessageTypeFlagsEXT type,
+    const VkDebugUtilsMessengerCallbackDataEXT *callbackDataPtr) -> bool {
+    if (static_cast<uint32_t>(severity) <
+        minimumSeverity_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    // Bounded MPMC queue after Dmitry Vyukov, used with a single consumer
+    Cell *cell;
+    size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+
+    for (;;) {
+        cell = &cells_[position & (capacity - 1)];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto difference =
+            static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0) {
+            if (enqueuePosition_.compare_exchange_weak(
+                    position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = enqueuePosition_.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->message.severity = severity;
+    cell->message.type = type;
+    cell->message.messageId = callbackDataPtr->messageIdNumber;
+
+    const char *text =
+        callbackDataPtr->pMessage != nullptr ? callbackDataPtr->pMessage : "";
+    size_t length = std::min(std::strlen(text), maxMessageLength - 1);
+    std::memcpy(cell->message.text, text, length);
+    cell->message.text[length] = '\0';
+
+    cell->sequence.store(position + 1, std::memory_order_release);
+    signal();
+
+    return true;
+}
+
+auto vulkanctx::ValidationSink::signal() -> void {
+    // Already signaled, the thread is awake or about to be
+    if (signaled_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    // Waits out a thread that checked the flag and is about to sleep
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+
+    woken_.notify_one();
+}
+
+auto vulkanctx::ValidationSink::tryDequeue(Message &message) -> bool {
+    Cell &cell = cells_[dequeuePosition_ & (capacity - 1)];
+    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+    if (sequence != dequeuePosition_ + 1) {
+        return false;
+    }
+
+    message = cell.message;
+    cell.sequence.store(dequeuePosition_ + capacity, std::memory_order_release);
+    dequeuePosition_++;
+
+    return true;
+}
+
+auto vulkanctx::ValidationSink::drain() -> void {
+    Message message;
+    bool wrote = false;
+
+    while (tryDequeue(message)) {
+        write(message);
+        wrote = true;
+    }
+
+    if (wrote) {
+        stream_.flush();
+    }
+}
+
+auto vulkanctx::ValidationSink::write(const Message &message) -> void {
+    auto key = messageKey(message.messageId, message.text);
+    auto repeat = repeats_.find(key);
+
+    // Only the first occurrence within a report interval is printed in full
+    if (repeat != repeats_.end()) {
+        repeat->second.count++;
+        return;
+    }
+
+    std::ostringstream summary;
+    if (message.messageId != 0) {
+        summary << "message ID 0x" << std::hex
+                << static_cast<uint32_t>(message.messageId);
+    } else {
+        summary << '"' << std::string_view(message.text).substr(0, 60)
+                << "...\"";
+    }
+
+    repeats_.emplace(key, Repeat{0, message.severity, summary.str()});
+
+    stream_ << "Validation layer (" << severityName(message.severity)
+            << "): " << message.text << '\n';
+}
+
+auto vulkanctx::ValidationSink::reportRepeats() -> void {
+    for (const auto &entry : repeats_) {
+        const auto &repeat = entry.second;
+
+        if (repeat.count > 0) {
+            stream_ << "Validation layer (" << severityName(repeat.severity)
+                    << "): " << repeat.summary << " repeated " << repeat.count
+                    << " more time(s)\n";
+        }
+    }
+
+    repeats_.clear();
+}
+
+auto vulkanctx::ValidationSink::setMinimumSeverity(
+    VkDebugUtilsMessageSeverityFlagBitsEXT severity) -> void {
+    minimumSeverity_.store(severity, std::memory_order_relaxed);
+}
+
+auto vulkanctx::ValidationSink::minimumSeverity() const
+    -> VkDebugUtilsMessageSeverityFlagBitsEXT {
+    return static_cast<VkDebugUtilsMessageSeverityFlagBitsEXT>(
+        minimumSeverity_.load(std::memory_order_relaxed));
+}
+
+auto vulkanctx::ValidationSink::droppedCount() const -> uint64_t {
+    return dropped_.load(std::memory_order_relaxed);
+}
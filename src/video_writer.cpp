@@ -0,0 +1,144 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "video_writer.h"
+
+vulkanctx::VideoWriter::VideoWriter(const std::string &path,
+                                    const uint32_t &frameRate)
+    : file_(std::fopen(path.c_str(), "wb")), frameRate_(frameRate) {
+    if (file_ == nullptr) {
+        throw std::runtime_error("Failed to open " + path + ": " +
+                                 std::strerror(errno));
+    }
+
+    worker_ = std::thread([this] { run(); });
+}
+
+vulkanctx::VideoWriter::~VideoWriter() { finish(); }
+
+auto vulkanctx::VideoWriter::finish() -> void {
+    if (!worker_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    changed_.notify_all();
+    worker_.join();
+
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+auto vulkanctx::VideoWriter::write(const ReadbackFrame &frame) -> void {
+    const bool planar = frame.format == VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM;
+
+    if (!planar && frame.format != VK_FORMAT_G8_B8R8_2PLANE_420_UNORM) {
+        throw std::runtime_error("Only 4:2:0 frames can be written as video");
+    }
+
+    Pending *pending;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock,
+                      [&] { return failed_ || !buffers_[nextBuffer_].queued; });
+
+        if (failed_) {
+            throw std::runtime_error("Failed to write video frame");
+        }
+
+        pending = &buffers_[nextBuffer_];
+        nextBuffer_ = (nextBuffer_ + 1) % 2;
+    }
+
+    // The writer leaves buffers alone until they are queued, so filling one
+    // doesn't need the lock
+    pending->data.clear();
+
+    if (planar) {
+        if (!headerWritten_) {
+            // The chroma is averaged over each 2x2 block, i.e. centre sited
+            std::string header = "YUV4MPEG2 W" +
+                                 std::to_string(frame.extent.width) + " H" +
+                                 std::to_string(frame.extent.height) + " F" +
+                                 std::to_string(frameRate_) +
+                                 ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+            pending->data.assign(header.begin(), header.end());
+            headerWritten_ = true;
+        }
+
+        static constexpr char frameHeader[] = "FRAME\n";
+        pending->data.insert(pending->data.end(),
+                             frameHeader,
+                             frameHeader + sizeof(frameHeader) - 1);
+    }
+
+    pending->data.insert(
+        pending->data.end(), frame.data, frame.data + frame.size);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending->queued = true;
+    }
+
+    changed_.notify_all();
+}
+
+auto vulkanctx::VideoWriter::run() -> void {
+    size_t index = 0;
+
+    for (;;) {
+        Pending *pending;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(
+                lock, [&] { return stopping_ || buffers_[index].queued; });
+
+            // Buffers are queued in order, so if this one isn't, none is
+            if (!buffers_[index].queued) {
+                return;
+            }
+
+            pending = &buffers_[index];
+        }
+
+        // Once writing failed, buffers are only handed back so that write()
+        // never waits forever
+        bool written = !failed_ && std::fwrite(pending->data.data(),
+                                                1,
+                                                pending->data.size(),
+                                                file_) == pending->data.size();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (written) {
+                framesWritten_++;
+                bytesWritten_ += pending->data.size();
+            } else {
+                failed_ = true;
+            }
+
+            pending->queued = false;
+        }
+
+        changed_.notify_all();
+        index = (index + 1) % 2;
+    }
+}
+
+auto vulkanctx::VideoWriter::framesWritten() const -> uint64_t {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return framesWritten_;
+}
+
+auto vulkanctx::VideoWriter::bytesWritten() const -> uint64_t {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytesWritten_;
+}
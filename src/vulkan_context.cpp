@@ -3,13 +3,24 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <optional>
 #include <set>
 #include <stdexcept>
-
+#include <type_traits>
+
+#include "async_compute.h"
+#include "debug_utils.h"
+#include "device_dispatch.h"
+#include "diagnostics.h"
+#include "frame_depth.h"
+#include "frame_readback.h"
+#include "host_allocator.h"
+#include "validation_sink.h"
 #include "vulkan_context.h"
 
 #define UNUSED(x) (void)(x)
@@ -18,6 +29,10 @@ struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
 
+    // Not needed for completeness, it falls back to the graphics family
+    std::optional<uint32_t> computeFamily;
+    uint32_t computeQueueIndex = 0;
+
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
@@ -43,11 +58,12 @@ static const std::vector<const char *> validationLayers = {
 static const std::vector<const char *> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-#ifdef NODEBUG
-static const bool enableValidationLayers = false;
-#else
-static const bool enableValidationLayers = true;
-#endif
+// Constant false in release builds, which lets the compiler drop every
+// diagnostics code path
+static auto validationEnabled() -> bool {
+    return vulkanctx::diagnosticsCompiledIn &&
+           vulkanctx::diagnosticsConfig().validation;
+}
 
 // ---------------------------------------------------------------------------//
 //                          Validation layer                                  //
@@ -58,14 +74,44 @@ debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
               VkDebugUtilsMessageTypeFlagsEXT messageType,
               const VkDebugUtilsMessengerCallbackDataEXT *callbackDataPtr,
               void *userDataPtr) {
-    UNUSED(messageSeverity);
-    UNUSED(messageType);
-    UNUSED(userDataPtr);
+    // Runs on the driver's thread inside the Vulkan call that triggered it, so
+    // only hand the message off and let the sink's thread do the printing
+    auto sink = static_cast<vulkanctx::ValidationSink *>(userDataPtr);
+    sink->enqueue(messageSeverity, messageType, callbackDataPtr);
 
-    std::cerr << "Validation layer: " << callbackDataPtr->pMessage << std::endl;
     return VK_FALSE;
 }
 
+// Reads the minimum reported severity from VULKANCTX_VALIDATION_SEVERITY,
+// which can be one of verbose, info, warning or error
+static auto severityFromEnvironment(
+    const VkDebugUtilsMessageSeverityFlagBitsEXT &fallback)
+    -> VkDebugUtilsMessageSeverityFlagBitsEXT {
+    const char *value = std::getenv("VULKANCTX_VALIDATION_SEVERITY");
+
+    if (value == nullptr) {
+        return fallback;
+    } else if (strcmp(value, "verbose") == 0) {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+    } else if (strcmp(value, "info") == 0) {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+    } else if (strcmp(value, "warning") == 0) {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+    } else if (strcmp(value, "error") == 0) {
+        return VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    }
+
+    std::cerr << "Unknown VULKANCTX_VALIDATION_SEVERITY '" << value
+              << "', reporting everything" << std::endl;
+
+    return fallback;
+}
+
+auto vulkanctx::validationSink() -> ValidationSink & {
+    static ValidationSink sink(std::cerr);
+    return sink;
+}
+
 static auto createDebugUtilsMessengerEXT(
     const VkInstance &instance,
     const VkDebugUtilsMessengerCreateInfoEXT *pCreateInfo,
@@ -81,17 +127,6 @@ static auto createDebugUtilsMessengerEXT(
     }
 }
 
-static auto
-destroyDebugUtilsMessengerEXT(const VkInstance &instance,
-                              const VkDebugUtilsMessengerEXT &debugMessenger,
-                              const VkAllocationCallbacks *pAllocator) -> void {
-    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
-        instance, "vkDestroyDebugUtilsMessengerEXT");
-    if (func != nullptr) {
-        func(instance, debugMessenger, pAllocator);
-    }
-}
-
 static auto
 populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo)
     -> void {
@@ -105,24 +140,28 @@ populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo)
                              VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
                              VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
     createInfo.pfnUserCallback = debugCallback;
+    createInfo.pUserData = &vulkanctx::validationSink();
 }
 
-auto vulkanctx::setupDebugMessenger(const VkInstance &instance)
-    -> VkDebugUtilsMessengerEXT {
-    if (!enableValidationLayers)
-        return nullptr;
+auto vulkanctx::setupDebugMessenger(const VkInstance &instance,
+                                    const char *file,
+                                    const int &line) -> UniqueDebugMessenger {
+    if (!validationEnabled())
+        return UniqueDebugMessenger();
 
     VkDebugUtilsMessengerCreateInfoEXT createInfo{};
     populateDebugMessengerCreateInfo(createInfo);
 
     VkDebugUtilsMessengerEXT debugMessenger;
 
-    if (createDebugUtilsMessengerEXT(
-            instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+    if (createDebugUtilsMessengerEXT(instance,
+                                     &createInfo,
+                                     hostAllocator(),
+                                     &debugMessenger) != VK_SUCCESS) {
         throw std::runtime_error("Failed to set up debug messenger");
     }
 
-    return debugMessenger;
+    return UniqueDebugMessenger(instance, debugMessenger, file, line);
 }
 
 static auto
@@ -151,23 +190,86 @@ checkValidationLayerSupport(const std::vector<const char *> &validationLayers)
     return true;
 }
 
+// Extra validation layer checks requested by the diagnostics configuration
+static auto getValidationFeatures()
+    -> std::vector<VkValidationFeatureEnableEXT> {
+    std::vector<VkValidationFeatureEnableEXT> features;
+
+    if (!validationEnabled()) {
+        return features;
+    }
+
+    const auto &config = vulkanctx::diagnosticsConfig();
+
+    if (config.gpuAssisted) {
+        features.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT);
+    }
+
+    if (config.bestPractices) {
+        features.push_back(VK_VALIDATION_FEATURE_ENABLE_BEST_PRACTICES_EXT);
+    }
+
+    if (config.synchronization) {
+        features.push_back(
+            VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT);
+    }
+
+    return features;
+}
+
 // ---------------------------------------------------------------------------//
 //                                  Extensions                                //
 // ---------------------------------------------------------------------------//
 
-static auto getRequiredExtensions(const bool &enableValidationLayers)
+// Object names and command buffer labels help capture tools as much as
+// the validation layer, so non-release builds want the extension either way
+static auto debugUtilsEnabled() -> bool {
+    if (!vulkanctx::diagnosticsCompiledIn) {
+        return false;
+    }
+
+    if (validationEnabled()) {
+        return true;
+    }
+
+    uint32_t extensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(
+        nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto &extension : availableExtensions) {
+        if (strcmp(extension.extensionName,
+                   VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static auto getRequiredExtensions(const bool &enableDebugUtils,
+                                  const bool &enableValidationFeatures,
+                                  const bool &headless)
     -> std::vector<const char *> {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions =
-        glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char *> extensions;
+
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char **glfwExtensions =
+            glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    std::vector<const char *> extensions(glfwExtensions,
-                                         glfwExtensions + glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
-    if (enableValidationLayers) {
+    if (enableDebugUtils) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    if (enableValidationFeatures) {
+        extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+    }
+
     return extensions;
 }
 
@@ -198,9 +300,11 @@ static auto checkDeviceExtensionSupport(const VkPhysicalDevice &device)
 //                           Instance & surface                               //
 // ---------------------------------------------------------------------------//
 
-auto vulkanctx::createInstance(const char *application_name) -> VkInstance {
-    if (enableValidationLayers &&
-        !checkValidationLayerSupport(validationLayers)) {
+auto vulkanctx::createInstance(const char *application_name,
+                               const bool &headless,
+                               const char *file,
+                               const int &line) -> UniqueInstance {
+    if (validationEnabled() && !checkValidationLayerSupport(validationLayers)) {
         throw std::runtime_error(
             "Validation layers requested, but not available");
     }
@@ -211,49 +315,73 @@ auto vulkanctx::createInstance(const char *application_name) -> VkInstance {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = instanceApiVersion();
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
-    auto extensions = getRequiredExtensions(enableValidationLayers);
+    auto validationFeatures = getValidationFeatures();
+
+    auto extensions = getRequiredExtensions(
+        debugUtilsEnabled(), !validationFeatures.empty(), headless);
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo;
+    VkValidationFeaturesEXT validationFeaturesInfo{};
 
-    if (enableValidationLayers) {
+    if (validationEnabled()) {
         createInfo.enabledLayerCount =
             static_cast<uint32_t>(validationLayers.size());
         createInfo.ppEnabledLayerNames = validationLayers.data();
 
+        // The sink has to be running before the instance exists to catch
+        // messages emitted during instance creation
+        validationSink().setMinimumSeverity(severityFromEnvironment(
+            VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT));
+        validationSink().start();
+
         populateDebugMessengerCreateInfo(debugCreateInfo);
         createInfo.pNext =
             (VkDebugUtilsMessengerCreateInfoEXT *)&debugCreateInfo;
+
+        if (!validationFeatures.empty()) {
+            validationFeaturesInfo.sType =
+                VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+            validationFeaturesInfo.enabledValidationFeatureCount =
+                static_cast<uint32_t>(validationFeatures.size());
+            validationFeaturesInfo.pEnabledValidationFeatures =
+                validationFeatures.data();
+            validationFeaturesInfo.pNext = createInfo.pNext;
+            createInfo.pNext = &validationFeaturesInfo;
+        }
     } else {
         createInfo.enabledLayerCount = 0;
         createInfo.pNext = nullptr;
     }
 
     VkInstance instance{};
-    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+    if (vkCreateInstance(&createInfo, hostAllocator(), &instance) !=
+        VK_SUCCESS) {
         throw std::runtime_error("Failed to create Vulkan instance");
     }
 
-    return instance;
+    return UniqueInstance(nullptr, instance, file, line);
 }
 
-auto vulkanctx::createSurface(const VkInstance &instance, GLFWwindow *window)
-    -> VkSurfaceKHR {
+auto vulkanctx::createSurface(const VkInstance &instance,
+                              GLFWwindow *window,
+                              const char *file,
+                              const int &line) -> UniqueSurface {
     VkSurfaceKHR surface;
 
-    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) !=
+    if (glfwCreateWindowSurface(instance, window, hostAllocator(), &surface) !=
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create window surface");
     }
 
-    return surface;
+    return UniqueSurface(instance, surface, file, line);
 }
 
 // ---------------------------------------------------------------------------//
@@ -309,36 +437,47 @@ auto vulkanctx::pickPhysicalDevice(const VkInstance &instance,
 }
 
 auto vulkanctx::createLogicalDevice(const VkPhysicalDevice &physicalDevice,
-                                    const VkSurfaceKHR &surface) -> VkDevice {
+                                    const VkSurfaceKHR &surface,
+                                    const DeviceFeatures &requestedFeatures,
+                                    const char *file,
+                                    const int &line) -> UniqueDevice {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
-                                              indices.presentFamily.value()};
+                                              indices.presentFamily.value(),
+                                              indices.computeFamily.value()};
 
-    float queuePriority = 1.0f;
+    float queuePriorities[] = {1.0f, 1.0f};
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
         queueCreateInfo.queueCount = 1;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfo.pQueuePriorities = queuePriorities;
+
+        if (queueFamily == indices.computeFamily.value()) {
+            queueCreateInfo.queueCount = indices.computeQueueIndex + 1;
+        }
+
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
+    std::vector<const char *> extensions = deviceExtensions;
+
+    DeviceFeatureChain features(physicalDevice, requestedFeatures);
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    features.attach(createInfo, extensions);
+
     createInfo.queueCreateInfoCount =
         static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount =
-        static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
-    if (enableValidationLayers) {
+    if (validationEnabled()) {
         createInfo.enabledLayerCount =
             static_cast<uint32_t>(validationLayers.size());
         createInfo.ppEnabledLayerNames = validationLayers.data();
@@ -347,12 +486,15 @@ auto vulkanctx::createLogicalDevice(const VkPhysicalDevice &physicalDevice,
     }
 
     VkDevice device;
-    if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) !=
+    if (vkCreateDevice(physicalDevice, &createInfo, hostAllocator(), &device) !=
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create logical device");
     }
 
-    return device;
+    loadDeviceDispatch(device);
+    setEnabledDeviceFeatures(features.enabled());
+
+    return UniqueDevice(nullptr, device, file, line);
 }
 
 // ---------------------------------------------------------------------------//
@@ -394,6 +536,28 @@ static auto findQueueFamilies(const VkPhysicalDevice &device,
         i++;
     }
 
+    if (!indices.graphicsFamily.has_value()) {
+        return indices;
+    }
+
+    // A family without graphics usually maps to separate hardware queues
+    for (uint32_t family = 0; family < queueFamilyCount; family++) {
+        const VkQueueFlags flags = queueFamilies[family].queueFlags;
+
+        if ((flags & VK_QUEUE_COMPUTE_BIT) &&
+            !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+            indices.computeFamily = family;
+            return indices;
+        }
+    }
+
+    // Otherwise a second queue of the graphics family, if it has one
+    indices.computeFamily = indices.graphicsFamily;
+
+    if (queueFamilies[indices.graphicsFamily.value()].queueCount > 1) {
+        indices.computeQueueIndex = 1;
+    }
+
     return indices;
 }
 
@@ -404,10 +568,43 @@ auto vulkanctx::getGraphicsQueue(const VkDevice &device,
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+    setObjectName(
+        device, VK_OBJECT_TYPE_QUEUE, graphicsQueue, "graphics queue");
 
     return graphicsQueue;
 }
 
+auto vulkanctx::getComputeQueue(const VkDevice &device,
+                                const VkPhysicalDevice &physicalDevice,
+                                const VkSurfaceKHR &surface) -> VkQueue {
+    VkQueue computeQueue;
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
+
+    vkGetDeviceQueue(device,
+                     indices.computeFamily.value(),
+                     indices.computeQueueIndex,
+                     &computeQueue);
+
+    // Unless it is the graphics queue, which keeps its name
+    if (indices.computeFamily != indices.graphicsFamily ||
+        indices.computeQueueIndex != 0) {
+        setObjectName(
+            device, VK_OBJECT_TYPE_QUEUE, computeQueue, "compute queue");
+    }
+
+    return computeQueue;
+}
+
+auto vulkanctx::graphicsQueueFamily(const VkPhysicalDevice &physicalDevice,
+                                    const VkSurfaceKHR &surface) -> uint32_t {
+    return findQueueFamilies(physicalDevice, surface).graphicsFamily.value();
+}
+
+auto vulkanctx::computeQueueFamily(const VkPhysicalDevice &physicalDevice,
+                                   const VkSurfaceKHR &surface) -> uint32_t {
+    return findQueueFamilies(physicalDevice, surface).computeFamily.value();
+}
+
 auto vulkanctx::getPresentQueue(const VkDevice &device,
                                 const VkPhysicalDevice &physicalDevice,
                                 const VkSurfaceKHR &surface) -> VkQueue {
@@ -419,6 +616,97 @@ auto vulkanctx::getPresentQueue(const VkDevice &device,
     return presentQueue;
 }
 
+auto vulkanctx::sharesPresentQueue(const VkPhysicalDevice &physicalDevice,
+                                   const VkSurfaceKHR &surface,
+                                   const VkSurfaceKHR &other) -> bool {
+    // The swap chain of other shares its images between the families picked
+    // for other, so those have to be the same as well
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
+    QueueFamilyIndices otherIndices = findQueueFamilies(physicalDevice, other);
+
+    return indices.isComplete() && otherIndices.isComplete() &&
+           indices.graphicsFamily == otherIndices.graphicsFamily &&
+           indices.presentFamily == otherIndices.presentFamily;
+}
+
+// ---------------------------------------------------------------------------//
+//                                  Memory                                    //
+// ---------------------------------------------------------------------------//
+
+auto vulkanctx::findMemoryType(const VkPhysicalDevice &physicalDevice,
+                               const uint32_t &typeFilter,
+                               const VkMemoryPropertyFlags &properties)
+    -> std::optional<uint32_t> {
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+                properties) {
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto vulkanctx::createBuffer(
+    const VkDevice &device,
+    const VkPhysicalDevice &physicalDevice,
+    const VkDeviceSize &size,
+    const VkBufferUsageFlags &usage,
+    const std::vector<VkMemoryPropertyFlags> &preferredProperties,
+    const char *file,
+    const int &line) -> Buffer {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+
+    if (vkCreateBuffer(device, &bufferInfo, hostAllocator(), &buffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create buffer");
+    }
+
+    UniqueBuffer handle(device, buffer, file, line);
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+    for (const auto &properties : preferredProperties) {
+        auto memoryType = findMemoryType(
+            physicalDevice, requirements.memoryTypeBits, properties);
+
+        if (!memoryType.has_value()) {
+            continue;
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = memoryType.value();
+
+        VkDeviceMemory memory;
+
+        if (vkAllocateMemory(device, &allocInfo, hostAllocator(), &memory) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate buffer memory");
+        }
+
+        UniqueDeviceMemory ownedMemory(device, memory, file, line);
+        vkBindBufferMemory(device, buffer, memory, 0);
+
+        return Buffer{
+            std::move(handle), std::move(ownedMemory), size, properties};
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type for buffer");
+}
+
 // ---------------------------------------------------------------------------//
 //                                 Swap chain                                 //
 // ---------------------------------------------------------------------------//
@@ -485,18 +773,14 @@ static auto chooseSwapPresentMode(
 }
 
 static auto chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities,
-                             GLFWwindow *glfwWindowPtr) -> VkExtent2D {
+                             const VkExtent2D &framebufferSize) -> VkExtent2D {
     // If the context don't allow us to differ in resolution of the swap
     // chain and the actual window
     if (capabilities.currentExtent.width != UINT32_MAX) {
         return capabilities.currentExtent;
     } else {
         // Elsewise we can pick the best resolution suited
-        int width, height;
-        glfwGetFramebufferSize(glfwWindowPtr, &width, &height);
-
-        VkExtent2D actualExtent = {static_cast<uint32_t>(width),
-                                   static_cast<uint32_t>(height)};
+        VkExtent2D actualExtent = framebufferSize;
 
         // Clamp between the minimum and maximum extents supported
         actualExtent.width = std::max(
@@ -514,8 +798,10 @@ static auto chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities,
 auto vulkanctx::createSwapChain(const VkDevice &device,
                                 const VkPhysicalDevice &physicalDevice,
                                 const VkSurfaceKHR &surface,
-                                GLFWwindow *glfwWindowPtr)
-    -> vulkanctx::SwapChain {
+                                const VkExtent2D &framebufferSize,
+                                const VkSwapchainKHR &oldSwapChain,
+                                const char *file,
+                                const int &line) -> vulkanctx::SwapChain {
     SwapChainSupportDetails swapChainSupport =
         querySwapChainSupport(physicalDevice, surface);
 
@@ -526,7 +812,7 @@ auto vulkanctx::createSwapChain(const VkDevice &device,
         chooseSwapPresentMode(swapChainSupport.presentModes);
 
     VkExtent2D extent =
-        chooseSwapExtent(swapChainSupport.capabilities, glfwWindowPtr);
+        chooseSwapExtent(swapChainSupport.capabilities, framebufferSize);
 
     // Have one image extra to prevent waiting for the driver
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -551,6 +837,11 @@ auto vulkanctx::createSwapChain(const VkDevice &device,
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+    // Allows frames to be copied or converted out of the presented images
+    createInfo.imageUsage |=
+        swapChainSupport.capabilities.supportedUsageFlags &
+        (VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
 
     uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(),
@@ -574,15 +865,23 @@ auto vulkanctx::createSwapChain(const VkDevice &device,
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+    // Lets the driver reuse what it can and keeps presenting the old images
+    // until the new swap chain takes over
+    createInfo.oldSwapchain = oldSwapChain;
 
     VkSwapchainKHR swapChain;
 
-    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain)) {
+    if (vkCreateSwapchainKHR(
+            device, &createInfo, hostAllocator(), &swapChain)) {
         throw std::runtime_error("Failed to create swap chain");
     }
 
-    return SwapChain{swapChain, imageCount, surfaceFormat.format, extent};
+    return SwapChain{UniqueSwapchain(device, swapChain, file, line),
+                     imageCount,
+                     surfaceFormat.format,
+                     extent,
+                     createInfo.imageUsage};
 }
 
 auto vulkanctx::retriveSwapChainImages(const VkDevice &device,
@@ -594,6 +893,16 @@ auto vulkanctx::retriveSwapChainImages(const VkDevice &device,
     swapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(
         device, swapChain, &imageCount, swapChainImages.data());
+
+    // Owned by the swap chain, so no UniqueHandle names them
+    for (uint32_t i = 0; i < imageCount; i++) {
+        setObjectName(device,
+                      VK_OBJECT_TYPE_IMAGE,
+                      swapChainImages[i],
+                      "swap chain image",
+                      static_cast<int>(i));
+    }
+
     return swapChainImages;
 }
 
@@ -603,10 +912,12 @@ auto vulkanctx::retriveSwapChainImages(const VkDevice &device,
 
 auto vulkanctx::createImageViews(const VkDevice &device,
                                  const std::vector<VkImage> &swapChainImages,
-                                 const VkFormat &swapChainImageFormat)
-    -> std::vector<VkImageView> {
-    std::vector<VkImageView> swapChainImageViews;
-    swapChainImageViews.resize(swapChainImages.size());
+                                 const VkFormat &swapChainImageFormat,
+                                 const char *file,
+                                 const int &line)
+    -> std::vector<UniqueImageView> {
+    std::vector<UniqueImageView> swapChainImageViews;
+    swapChainImageViews.reserve(swapChainImages.size());
 
     for (size_t i = 0; i < swapChainImages.size(); i++) {
         VkImageViewCreateInfo createInfo{};
@@ -624,12 +935,17 @@ auto vulkanctx::createImageViews(const VkDevice &device,
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
 
+        VkImageView imageView;
+
         VkResult result = vkCreateImageView(
-            device, &createInfo, nullptr, &swapChainImageViews[i]);
+            device, &createInfo, hostAllocator(), &imageView);
 
         if (result != VK_SUCCESS) {
             throw std::runtime_error("Failed to create image view");
         }
+
+        swapChainImageViews.push_back(
+            UniqueImageView(device, imageView, file, line));
     }
 
     return swapChainImageViews;
@@ -639,7 +955,8 @@ auto vulkanctx::createImageViews(const VkDevice &device,
 //                                Shaders                                     //
 // ---------------------------------------------------------------------------//
 
-static auto readFile(const std::string &fileName) -> std::vector<char> {
+auto vulkanctx::readShaderFile(const std::string &fileName)
+    -> std::vector<char> {
     // Start reading at end of the file and specify that the file is binary
     std::ifstream file(fileName, std::ios::ate | std::ios::binary);
 
@@ -659,9 +976,10 @@ static auto readFile(const std::string &fileName) -> std::vector<char> {
     return buffer;
 }
 
-static auto createShaderModule(const VkDevice &device,
-                               const std::vector<char> &code)
-    -> VkShaderModule {
+auto vulkanctx::createShaderModule(const VkDevice &device,
+                                   const std::vector<char> &code,
+                                   const char *file,
+                                   const int &line) -> UniqueShaderModule {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     createInfo.codeSize = code.size();
@@ -669,14 +987,14 @@ static auto createShaderModule(const VkDevice &device,
 
     VkShaderModule shaderModule;
 
-    VkResult result =
-        vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule);
+    VkResult result = vkCreateShaderModule(
+        device, &createInfo, hostAllocator(), &shaderModule);
 
     if (result != VK_SUCCESS) {
         throw std::runtime_error("Failed to create shader module");
     }
 
-    return shaderModule;
+    return UniqueShaderModule(device, shaderModule, file, line);
 }
 
 // ---------------------------------------------------------------------------//
@@ -684,8 +1002,10 @@ static auto createShaderModule(const VkDevice &device,
 // ---------------------------------------------------------------------------//
 
 auto vulkanctx::createRenderPass(const VkDevice &device,
-                                 const VkFormat &swapChainFormat)
-    -> VkRenderPass {
+                                 const VkFormat &swapChainFormat,
+                                 const VkImageLayout &finalLayout,
+                                 const char *file,
+                                 const int &line) -> UniqueRenderPass {
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = swapChainFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -694,7 +1014,7 @@ auto vulkanctx::createRenderPass(const VkDevice &device,
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = finalLayout;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -705,13 +1025,29 @@ auto vulkanctx::createRenderPass(const VkDevice &device,
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
 
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // Makes the rendered image visible to a readback copy recorded after the
+    // render pass, or to the host when the image memory is mapped directly
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask =
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                   VK_PIPELINE_STAGE_HOST_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT |
+                                    VK_ACCESS_SHADER_READ_BIT |
+                                    VK_ACCESS_HOST_READ_BIT;
 
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -719,29 +1055,48 @@ auto vulkanctx::createRenderPass(const VkDevice &device,
     renderPassInfo.pAttachments = &colorAttachment;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
 
     VkRenderPass renderPass;
 
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) !=
+    if (vkCreateRenderPass(
+            device, &renderPassInfo, hostAllocator(), &renderPass) !=
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create render pass.");
     }
 
-    return renderPass;
+    return UniqueRenderPass(device, renderPass, file, line);
 }
 
 auto vulkanctx::createGraphicsPipeline(const VkDevice &device,
                                        const VkRenderPass &renderPass,
-                                       const VkExtent2D &swapChainExtent)
+                                       const VkExtent2D &swapChainExtent,
+                                       const char *file,
+                                       const int &line)
     -> vulkanctx::GraphicsPipeline {
-    auto vertexShaderCode = readFile("shaders/shader.vert.spv");
-    auto fragmentShaderCode = readFile("shaders/shader.frag.spv");
+    return createGraphicsPipeline(device,
+                                  renderPass,
+                                  swapChainExtent,
+                                  readShaderFile("shaders/shader.vert.spv"),
+                                  readShaderFile("shaders/shader.frag.spv"),
+                                  file,
+                                  line);
+}
 
-    VkShaderModule vertexShaderModule =
-        createShaderModule(device, vertexShaderCode);
-    VkShaderModule fragmentShaderModule =
-        createShaderModule(device, fragmentShaderCode);
+auto vulkanctx::createGraphicsPipeline(
+    const VkDevice &device,
+    const VkRenderPass &renderPass,
+    const VkExtent2D &swapChainExtent,
+    const std::vector<char> &vertexShaderCode,
+    const std::vector<char> &fragmentShaderCode,
+    const char *file,
+    const int &line) -> vulkanctx::GraphicsPipeline {
+    // Only needed until the pipeline has been created
+    UniqueShaderModule vertexShaderModule =
+        createShaderModule(device, vertexShaderCode, file, line);
+    UniqueShaderModule fragmentShaderModule =
+        createShaderModule(device, fragmentShaderCode, file, line);
 
     VkPipelineShaderStageCreateInfo vertexShaderStageInfo{};
     vertexShaderStageInfo.sType =
@@ -847,11 +1202,13 @@ auto vulkanctx::createGraphicsPipeline(const VkDevice &device,
     VkPipelineLayout pipelineLayout;
 
     if (vkCreatePipelineLayout(
-            device, &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+            device, &pipelineLayoutInfo, hostAllocator(), &pipelineLayout) !=
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create pipeline layout");
     }
 
+    UniquePipelineLayout layout(device, pipelineLayout, file, line);
+
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = 2;
@@ -869,18 +1226,123 @@ auto vulkanctx::createGraphicsPipeline(const VkDevice &device,
 
     VkPipeline pipeline;
 
-    if (vkCreateGraphicsPipelines(
-            device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) !=
-        VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device,
+                                  VK_NULL_HANDLE,
+                                  1,
+                                  &pipelineInfo,
+                                  hostAllocator(),
+                                  &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create graphics pipeline");
     }
 
-    // Can destroy the shader modules as they are loaded into the pipeline and
-    // no longer needed
-    vkDestroyShaderModule(device, vertexShaderModule, nullptr);
-    vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+    return GraphicsPipeline{std::move(layout),
+                            UniquePipeline(device, pipeline, file, line)};
+}
+
+auto vulkanctx::createComputePipeline(
+    const VkDevice &device,
+    const std::vector<char> &shaderCode,
+    const std::vector<VkDescriptorType> &bindings,
+    const uint32_t &pushConstantSize,
+    const std::vector<SpecializationConstant> &specialization,
+    const char *file,
+    const int &line) -> ComputePipeline {
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings(bindings.size());
+
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = bindings[i];
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+    setLayoutInfo.pBindings = layoutBindings.data();
+
+    VkDescriptorSetLayout descriptorSetLayout;
+
+    if (vkCreateDescriptorSetLayout(device,
+                                    &setLayoutInfo,
+                                    hostAllocator(),
+                                    &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout");
+    }
+
+    UniqueDescriptorSetLayout setLayout(
+        device, descriptorSetLayout, file, line);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    VkPipelineLayout pipelineLayout;
+
+    if (vkCreatePipelineLayout(
+            device, &pipelineLayoutInfo, hostAllocator(), &pipelineLayout) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout");
+    }
 
-    return GraphicsPipeline{pipelineLayout, pipeline};
+    UniquePipelineLayout layout(device, pipelineLayout, file, line);
+
+    // Every constant is 4 bytes, laid out in the order given
+    std::vector<VkSpecializationMapEntry> mapEntries(specialization.size());
+    std::vector<uint32_t> values(specialization.size());
+
+    for (uint32_t i = 0; i < specialization.size(); i++) {
+        mapEntries[i].constantID = specialization[i].id;
+        mapEntries[i].offset = i * sizeof(uint32_t);
+        mapEntries[i].size = sizeof(uint32_t);
+        values[i] = specialization[i].value;
+    }
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount =
+        static_cast<uint32_t>(mapEntries.size());
+    specializationInfo.pMapEntries = mapEntries.data();
+    specializationInfo.dataSize = values.size() * sizeof(uint32_t);
+    specializationInfo.pData = values.data();
+
+    UniqueShaderModule shaderModule =
+        createShaderModule(device, shaderCode, file, line);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo =
+        specialization.empty() ? nullptr : &specializationInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline;
+
+    if (vkCreateComputePipelines(device,
+                                 VK_NULL_HANDLE,
+                                 1,
+                                 &pipelineInfo,
+                                 hostAllocator(),
+                                 &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline");
+    }
+
+    return ComputePipeline{std::move(setLayout),
+                           std::move(layout),
+                           UniquePipeline(device, pipeline, file, line),
+                           pushConstantSize};
 }
 
 // ---------------------------------------------------------------------------//
@@ -890,10 +1352,12 @@ auto vulkanctx::createGraphicsPipeline(const VkDevice &device,
 auto vulkanctx::createFramebuffers(
     const VkDevice &device,
     const VkRenderPass &renderPass,
-    const std::vector<VkImageView> &swapChainImageViews,
-    const VkExtent2D &swapChainExtent) -> std::vector<VkFramebuffer> {
-    std::vector<VkFramebuffer> swapChainFramebuffers(
-        swapChainImageViews.size());
+    const std::vector<UniqueImageView> &swapChainImageViews,
+    const VkExtent2D &swapChainExtent,
+    const char *file,
+    const int &line) -> std::vector<UniqueFramebuffer> {
+    std::vector<UniqueFramebuffer> swapChainFramebuffers;
+    swapChainFramebuffers.reserve(swapChainImageViews.size());
 
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
         VkImageView attachments[] = {swapChainImageViews[i]};
@@ -907,11 +1371,16 @@ auto vulkanctx::createFramebuffers(
         framebufferInfo.height = swapChainExtent.height;
         framebufferInfo.layers = 1;
 
+        VkFramebuffer framebuffer;
+
         if (vkCreateFramebuffer(
-                device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) !=
+                device, &framebufferInfo, hostAllocator(), &framebuffer) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to create framebuffer");
         }
+
+        swapChainFramebuffers.push_back(
+            UniqueFramebuffer(device, framebuffer, file, line));
     }
 
     return swapChainFramebuffers;
@@ -923,8 +1392,9 @@ auto vulkanctx::createFramebuffers(
 
 auto vulkanctx::createCommandPool(const VkDevice &device,
                                   const VkPhysicalDevice &physicalDevice,
-                                  const VkSurfaceKHR &surface)
-    -> VkCommandPool {
+                                  const VkSurfaceKHR &surface,
+                                  const char *file,
+                                  const int &line) -> UniqueCommandPool {
     VkCommandPool commandPool;
 
     QueueFamilyIndices queueFamilyIndices =
@@ -934,12 +1404,12 @@ auto vulkanctx::createCommandPool(const VkDevice &device,
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) !=
+    if (vkCreateCommandPool(device, &poolInfo, hostAllocator(), &commandPool) !=
         VK_SUCCESS) {
         throw std::runtime_error("Failed to create command pool!");
     }
 
-    return commandPool;
+    return UniqueCommandPool(device, commandPool, file, line);
 }
 
 auto vulkanctx::createCommandBuffers(
@@ -948,8 +1418,9 @@ auto vulkanctx::createCommandBuffers(
     const VkRenderPass &renderPass,
     const VkPipeline &graphicsPipeline,
     const VkCommandPool &commandPool,
-    const std::vector<VkFramebuffer> &swapChainFramebuffers)
-    -> std::vector<VkCommandBuffer> {
+    const std::vector<UniqueFramebuffer> &swapChainFramebuffers,
+    const char *file,
+    const int &line) -> std::vector<UniqueCommandBuffer> {
     std::vector<VkCommandBuffer> commandBuffers(swapChainFramebuffers.size());
 
     VkCommandBufferAllocateInfo allocInfo{};
@@ -963,6 +1434,21 @@ auto vulkanctx::createCommandBuffers(
         throw std::runtime_error("Failed to create command buffers");
     }
 
+    // Owned right away so that a failed recording doesn't leak them
+    std::vector<UniqueCommandBuffer> ownedCommandBuffers;
+    ownedCommandBuffers.reserve(commandBuffers.size());
+
+    for (const auto &commandBuffer : commandBuffers) {
+        ownedCommandBuffers.push_back(
+            UniqueCommandBuffer(CommandBufferParent{device, commandPool},
+                                commandBuffer,
+                                file,
+                                line));
+        ownedCommandBuffers.back().setName(
+            "draw command buffer",
+            static_cast<int>(ownedCommandBuffers.size() - 1));
+    }
+
     for (size_t i = 0; i < commandBuffers.size(); i++) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -983,214 +1469,685 @@ auto vulkanctx::createCommandBuffers(
         renderPassInfo.clearValueCount = 1;
         renderPassInfo.pClearValues = &clearColor;
 
-        vkCmdBeginRenderPass(
-            commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        {
+            DebugLabel label(commandBuffers[i], "triangle");
+
+            vkCmdBeginRenderPass(commandBuffers[i],
+                                 &renderPassInfo,
+                                 VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(commandBuffers[i],
-                          VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          graphicsPipeline);
+            vkCmdBindPipeline(commandBuffers[i],
+                              VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              graphicsPipeline);
 
-        vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
+            vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
 
-        vkCmdEndRenderPass(commandBuffers[i]);
+            vkCmdEndRenderPass(commandBuffers[i]);
+        }
 
         if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
     }
 
-    return commandBuffers;
+    return ownedCommandBuffers;
+}
+
+auto vulkanctx::groupCount(const uint32_t &count, const uint32_t &groupSize)
+    -> uint32_t {
+    return (count + groupSize - 1) / groupSize;
+}
+
+static auto bindCompute(const VkCommandBuffer &commandBuffer,
+                        const vulkanctx::ComputePipeline &pipeline,
+                        const VkDescriptorSet &descriptorSet,
+                        const void *pushConstants) -> void {
+    vulkanctx::vkCmdBindPipeline(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.handle);
+    vulkanctx::vkCmdBindDescriptorSets(commandBuffer,
+                                       VK_PIPELINE_BIND_POINT_COMPUTE,
+                                       pipeline.layout,
+                                       0,
+                                       1,
+                                       &descriptorSet,
+                                       0,
+                                       nullptr);
+
+    if (pipeline.pushConstantSize > 0) {
+        vulkanctx::vkCmdPushConstants(commandBuffer,
+                                      pipeline.layout,
+                                      VK_SHADER_STAGE_COMPUTE_BIT,
+                                      0,
+                                      pipeline.pushConstantSize,
+                                      pushConstants);
+    }
+}
+
+auto vulkanctx::recordDispatch(const VkCommandBuffer &commandBuffer,
+                               const ComputePipeline &pipeline,
+                               const VkDescriptorSet &descriptorSet,
+                               const void *pushConstants,
+                               const VkExtent3D &groupCounts) -> void {
+    bindCompute(commandBuffer, pipeline, descriptorSet, pushConstants);
+    vkCmdDispatch(commandBuffer,
+                  groupCounts.width,
+                  groupCounts.height,
+                  groupCounts.depth);
+}
+
+auto vulkanctx::recordDispatchIndirect(const VkCommandBuffer &commandBuffer,
+                                       const ComputePipeline &pipeline,
+                                       const VkDescriptorSet &descriptorSet,
+                                       const void *pushConstants,
+                                       const VkBuffer &buffer,
+                                       const VkDeviceSize &offset) -> void {
+    bindCompute(commandBuffer, pipeline, descriptorSet, pushConstants);
+    vkCmdDispatchIndirect(commandBuffer, buffer, offset);
+}
+
+auto vulkanctx::submitImmediate(
+    const VkDevice &device,
+    const VkQueue &queue,
+    const VkCommandPool &commandPool,
+    const std::function<void(const VkCommandBuffer &)> &record) -> void {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer rawCommandBuffer;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &rawCommandBuffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command buffers");
+    }
+
+    UniqueCommandBuffer commandBuffer(CommandBufferParent{device, commandPool},
+                                      rawCommandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffers.");
+    }
+
+    record(commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence rawFence;
+
+    if (vkCreateFence(device, &fenceInfo, hostAllocator(), &rawFence) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fence");
+    }
+
+    UniqueFence fence(device, rawFence);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer.get();
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit command buffer");
+    }
+
+    vkWaitForFences(device, 1, &fence.get(), VK_TRUE, UINT64_MAX);
 }
 
+// Long enough for a few refreshes at any rate, short enough that a window
+// which stopped presenting, e.g. one being minimized, barely stalls the loop
+static constexpr uint64_t presentWaitTimeout = 100'000'000;
+
 auto vulkanctx::drawFrame(const VkDevice &device,
-                          const vulkanctx::SwapChain &swapChain,
-                          const std::vector<VkCommandBuffer> &commandBuffers,
+                          std::vector<PresentTarget> &targets,
                           const VkQueue &graphicsQueue,
                           const VkQueue &presentQueue,
                           SynchronizationObject &synchronizationObject,
-                          const uint32_t &currentFrame) -> void {
-    vkWaitForFences(device,
-                    1,
-                    &synchronizationObject.inFlightFences[currentFrame],
-                    VK_TRUE,
-                    UINT64_MAX);
+                          const uint32_t &currentFrame,
+                          const FramePacing::Clock::time_point &inputTime,
+                          FrameReadback *readback,
+                          AsyncCompute *compute,
+                          FrameDepthController *depth) -> void {
+    const VkFence &inFlightFence =
+        synchronizationObject.inFlightFences[currentFrame].get();
+
+    FrameWaits &waits = synchronizationObject.waits;
+    waits = {};
+
+    // Time spent blocked on the GPU or the display isn't the CPU's work
+    auto blockedStart = FramePacing::Clock::now();
+    vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    FramePacing::Clock::duration blocked =
+        FramePacing::Clock::now() - blockedStart;
+    waits.fence = blocked;
+
+    // Fences of a queue signal in submission order, so every frame up to the
+    // one guarded by this fence is done with its resources
+    synchronizationObject.retiredFrame =
+        std::max(synchronizationObject.retiredFrame,
+                 synchronizationObject.fenceFrames[currentFrame]);
+
+    // The copy made by the last frame in this slot is complete now
+    if (readback != nullptr) {
+        readback->collect(currentFrame);
+    }
 
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(
-        device,
-        swapChain.handle,
-        UINT64_MAX,
-        synchronizationObject.imageAvailableSemaphores[currentFrame],
-        VK_NULL_HANDLE,
-        &imageIndex);
+    if (compute != nullptr) {
+        compute->collect(currentFrame);
+    }
 
-    // Check if a previous frame is using this image
-    if (synchronizationObject.imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device,
-                        1,
-                        &synchronizationObject.imagesInFlight[imageIndex],
-                        VK_TRUE,
-                        UINT64_MAX);
+    if (depth != nullptr) {
+        depth->collect(currentFrame);
     }
 
-    // Mark the image as now being in use by this frame
-    synchronizationObject.imagesInFlight[imageIndex] =
-        synchronizationObject.inFlightFences[currentFrame];
+    const uint64_t frame = synchronizationObject.submittedFrame + 1;
+    const bool lateAcquire = synchronizationObject.lowLatency;
 
-    VkSemaphore waitSemaphores[] = {
-        synchronizationObject.imageAvailableSemaphores[currentFrame]};
-    VkSemaphore signalSemaphores[] = {
-        synchronizationObject.renderFinishedSemaphores[currentFrame]};
+    // Everything the frame records goes ahead of the acquire, which may
+    // block until the display frees an image. The compute work is then owed
+    // a graphics submission even if no window can be drawn.
+    if (compute != nullptr && lateAcquire) {
+        compute->submit(currentFrame, frame);
+    }
 
-    VkPipelineStageFlags waitStages[] = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    std::vector<PresentTarget *> &acquired =
+        synchronizationObject.presentTargets;
+    std::vector<VkSwapchainKHR> &swapChains =
+        synchronizationObject.presentSwapChains;
+    std::vector<uint32_t> &imageIndices =
+        synchronizationObject.presentImageIndices;
+    std::vector<VkResult> &results = synchronizationObject.presentResults;
+    std::vector<uint64_t> &presentIds = synchronizationObject.presentIds;
+
+    acquired.clear();
+    swapChains.clear();
+    imageIndices.clear();
+    presentIds.clear();
+
+    for (auto &target : targets) {
+        if (target.paused) {
+            continue;
+        }
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+        uint32_t imageIndex;
+        const auto acquireStart = FramePacing::Clock::now();
+        VkResult acquireResult = vkAcquireNextImageKHR(
+            device,
+            target.resources.swapChain.handle,
+            UINT64_MAX,
+            target.imageAvailableSemaphores[currentFrame],
+            VK_NULL_HANDLE,
+            &imageIndex);
+        const auto acquireWait = FramePacing::Clock::now() - acquireStart;
+        target.pacing.acquired(acquireWait);
+        waits.acquire = std::max(waits.acquire, acquireWait);
+        blocked += acquireWait;
+
+        // A failed acquire leaves the semaphore unsignaled, so there is
+        // nothing to undo. A suboptimal one did acquire an image and signals
+        // the semaphore, which only a submission waiting on it consumes, so
+        // that window is drawn and presented as usual.
+        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            target.status = FrameStatus::OutOfDate;
+            target.pacing.dropped();
+            continue;
+        } else if (acquireResult != VK_SUCCESS &&
+                   acquireResult != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("Failed to acquire swap chain image");
+        }
 
-    vkResetFences(
-        device, 1, &synchronizationObject.inFlightFences[currentFrame]);
+        target.status = acquireResult == VK_SUBOPTIMAL_KHR
+                            ? FrameStatus::Suboptimal
+                            : FrameStatus::Presented;
+
+        // Check if a previous frame is using this image
+        if (target.imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+            const auto imageWaitStart = FramePacing::Clock::now();
+            vkWaitForFences(device,
+                            1,
+                            &target.imagesInFlight[imageIndex],
+                            VK_TRUE,
+                            UINT64_MAX);
+            waits.fence += FramePacing::Clock::now() - imageWaitStart;
+        }
 
-    if (vkQueueSubmit(graphicsQueue,
-                      1,
-                      &submitInfo,
-                      synchronizationObject.inFlightFences[currentFrame]) !=
-        VK_SUCCESS) {
+        // Mark the image as now being in use by this frame
+        target.imagesInFlight[imageIndex] = inFlightFence;
+
+        acquired.push_back(&target);
+        swapChains.push_back(target.resources.swapChain.handle);
+        imageIndices.push_back(imageIndex);
+        presentIds.push_back(target.presentId + 1);
+    }
+
+    if (acquired.empty() && !(compute != nullptr && lateAcquire)) {
+        return;
+    }
+
+    // The readback was prepared for the first target's swap chain
+    const bool readBack = readback != nullptr && !acquired.empty() &&
+                          acquired.front() == &targets.front();
+
+    SubmissionBuilder &submission = synchronizationObject.submission;
+    const VkSemaphore &renderFinished =
+        synchronizationObject.renderFinishedSemaphores[currentFrame].get();
+
+    // Work added by others before the frame shouldn't wait for the acquires
+    submission.nextBatch();
+
+    for (const auto *target : acquired) {
+        submission.wait(target->imageAvailableSemaphores[currentFrame],
+                        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+
+    if (depth != nullptr) {
+        submission.add(depth->begin(currentFrame));
+    }
+
+    if (compute != nullptr) {
+        if (!lateAcquire) {
+            compute->submit(currentFrame, frame);
+        }
+
+        submission.wait(
+            compute->computeTimeline(), compute->consumerStage(), frame);
+        submission.add(compute->graphicsBegin(currentFrame));
+    }
+
+    for (size_t i = 0; i < acquired.size(); i++) {
+        submission.add(
+            acquired[i]->resources.commandBuffers[imageIndices[i]]);
+    }
+
+    if (readBack) {
+        submission.add(
+            readback->commandBuffer(currentFrame, imageIndices.front()));
+    }
+
+    if (compute != nullptr) {
+        submission.add(compute->graphicsEnd(currentFrame));
+        submission.signal(compute->graphicsTimeline(),
+                          VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                          frame);
+    }
+
+    if (depth != nullptr) {
+        submission.add(depth->end(currentFrame));
+    }
+
+    // A single semaphore covers every window, the present waits for all of
+    // them at once. Nothing would wait for it without a window.
+    if (!acquired.empty()) {
+        submission.signal(renderFinished,
+                          VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+    }
+
+    vkResetFences(device, 1, &inFlightFence);
+
+    const auto cpuTime = FramePacing::Clock::now() - inputTime - blocked;
+
+    if (submission.flush(graphicsQueue, inFlightFence) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit draw command buffer");
     }
 
+    if (depth != nullptr) {
+        depth->submitted(
+            currentFrame,
+            std::max(cpuTime, FramePacing::Clock::duration::zero()));
+    }
+
+    synchronizationObject.fenceFrames[currentFrame] = frame;
+    synchronizationObject.submittedFrame = frame;
+
+    if (readBack) {
+        readback->submitted(currentFrame,
+                            synchronizationObject.submittedFrame);
+    }
+
+    if (acquired.empty()) {
+        return;
+    }
+
+    results.assign(acquired.size(), VK_SUCCESS);
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &renderFinished;
+    presentInfo.swapchainCount = static_cast<uint32_t>(swapChains.size());
+    presentInfo.pSwapchains = swapChains.data();
+    presentInfo.pImageIndices = imageIndices.data();
+    presentInfo.pResults = results.data();
+
+    VkPresentIdKHR presentIdInfo{};
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = presentInfo.swapchainCount;
+    presentIdInfo.pPresentIds = presentIds.data();
+
+    if (enabledDeviceFeatures().presentId) {
+        presentInfo.pNext = &presentIdInfo;
+    }
 
-    VkSwapchainKHR swapChains[] = {swapChain.handle};
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex;
+    // Even a rejected present still waits on the render finished semaphore.
+    // The result of the call is the worst of all swap chains, each one's own
+    // is in results.
+    const auto presentStart = FramePacing::Clock::now();
+    VkResult presentResult = vkQueuePresentKHR(presentQueue, &presentInfo);
+    const auto presentTime = FramePacing::Clock::now();
+    waits.present = presentTime - presentStart;
+
+    if (presentResult != VK_SUCCESS && presentResult != VK_SUBOPTIMAL_KHR &&
+        presentResult != VK_ERROR_OUT_OF_DATE_KHR) {
+        throw std::runtime_error("Failed to present swap chain image");
+    }
+
+    // Otherwise waitForPresents measures the latency once the frame is shown
+    const bool waitsForPresent =
+        synchronizationObject.lowLatency && enabledDeviceFeatures().presentWait;
+
+    for (size_t i = 0; i < acquired.size(); i++) {
+        PresentTarget &target = *acquired[i];
 
-    vkQueuePresentKHR(presentQueue, &presentInfo);
+        // Used up even by a present that failed
+        target.presentId = presentIds[i];
+
+        if (results[i] == VK_ERROR_OUT_OF_DATE_KHR) {
+            target.status = FrameStatus::OutOfDate;
+            target.pacing.dropped();
+            continue;
+        } else if (results[i] == VK_SUBOPTIMAL_KHR) {
+            target.status = FrameStatus::Suboptimal;
+        } else if (results[i] != VK_SUCCESS) {
+            throw std::runtime_error("Failed to present swap chain image");
+        }
+
+        target.pacing.presented(presentTime);
+        target.presentInput = inputTime;
+        target.presentPending = waitsForPresent;
+
+        if (!waitsForPresent) {
+            target.pacing.latency(presentTime - inputTime, false);
+        }
+    }
+}
+
+auto vulkanctx::waitForPresents(const VkDevice &device,
+                                std::vector<PresentTarget> &targets) -> void {
+    if (!enabledDeviceFeatures().presentWait) {
+        return;
+    }
+
+    for (auto &target : targets) {
+        if (!target.presentPending) {
+            continue;
+        }
+
+        VkResult result = vkWaitForPresentKHR(device,
+                                              target.resources.swapChain.handle,
+                                              target.presentId,
+                                              presentWaitTimeout);
+        target.presentPending = false;
+
+        // A suboptimal swap chain still showed the frame. One that went out
+        // of date may never show it. Either way the next drawFrame finds out
+        // as well and recreates it.
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+            target.pacing.latency(
+                FramePacing::Clock::now() - target.presentInput, true);
+        } else if (result != VK_TIMEOUT &&
+                   result != VK_ERROR_OUT_OF_DATE_KHR) {
+            throw std::runtime_error("Failed to wait for present");
+        }
+    }
 }
 
 // ---------------------------------------------------------------------------//
 //                              Cleanup and misc                              //
 // ---------------------------------------------------------------------------//
 
-auto vulkanctx::createSynchronizationObject(const VkDevice &device,
-                                            const uint32_t &amount,
-                                            const uint32_t &swapChainImagesSize)
-    -> SynchronizationObject {
-    std::vector<VkSemaphore> imageAvailableSemaphores(amount);
-    std::vector<VkSemaphore> renderFinishedSemaphores(amount);
-    std::vector<VkFence> inFlightFences(amount);
-    std::vector<VkFence> imagesInFlight(swapChainImagesSize, VK_NULL_HANDLE);
+auto vulkanctx::createSemaphores(const VkDevice &device,
+                                 const uint32_t &count,
+                                 const char *name,
+                                 const uint32_t &firstSlot,
+                                 const char *file,
+                                 const int &line)
+    -> std::vector<UniqueSemaphore> {
+    std::vector<UniqueSemaphore> semaphores;
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+    for (size_t i = 0; i < count; i++) {
+        VkSemaphore semaphore;
+
+        if (vkCreateSemaphore(
+                device, &semaphoreInfo, hostAllocator(), &semaphore) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to create semaphore");
+        }
+
+        semaphores.push_back(UniqueSemaphore(device, semaphore, file, line));
+        semaphores.back().setName(name, firstSlot + i);
+    }
+
+    return semaphores;
+}
+
+// Signaled, as if the frames before the first one were done
+static auto createInFlightFences(const VkDevice &device,
+                                 const uint32_t &count,
+                                 const uint32_t &firstSlot = 0,
+                                 const char *file = __builtin_FILE(),
+                                 const int &line = __builtin_LINE())
+    -> std::vector<vulkanctx::UniqueFence> {
+    std::vector<vulkanctx::UniqueFence> inFlightFences;
+
     VkFenceCreateInfo fenceInfo{};
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < amount; i++) {
-        if (vkCreateSemaphore(device,
-                              &semaphoreInfo,
-                              nullptr,
-                              &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device,
-                              &semaphoreInfo,
-                              nullptr,
-                              &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) !=
-                VK_SUCCESS) {
-            throw std::runtime_error("Failed to create semaphore");
+    for (size_t i = 0; i < count; i++) {
+        VkFence inFlightFence;
+
+        if (vulkanctx::vkCreateFence(device,
+                                     &fenceInfo,
+                                     vulkanctx::hostAllocator(),
+                                     &inFlightFence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create fence");
         }
+
+        inFlightFences.push_back(
+            vulkanctx::UniqueFence(device, inFlightFence, file, line));
+        inFlightFences.back().setName("in flight fence", firstSlot + i);
     }
 
-    return SynchronizationObject{amount,
-                                 imageAvailableSemaphores,
-                                 renderFinishedSemaphores,
-                                 inFlightFences,
-                                 imagesInFlight};
+    return inFlightFences;
 }
 
-// auto vulkanctx::cleanupSwapChain() -> void {}
+auto vulkanctx::createSynchronizationObject(const VkDevice &device,
+                                            const uint32_t &amount,
+                                            const char *file,
+                                            const int &line)
+    -> SynchronizationObject {
+    return SynchronizationObject{
+        amount,
+        createSemaphores(
+            device, amount, "render finished semaphore", 0, file, line),
+        createInFlightFences(device, amount, 0, file, line),
+        std::vector<uint64_t>(amount, 0)};
+}
 
-auto vulkanctx::recreateSwapChain(const VkDevice &device,
-                                  const VkPhysicalDevice &physicalDevice,
-                                  const VkSurfaceKHR &surface,
-                                  GLFWwindow *glfwWindowPtr) -> void {
+auto vulkanctx::resizeFramesInFlight(
+    const VkDevice &device,
+    const VkQueue &presentQueue,
+    std::vector<PresentTarget> &targets,
+    SynchronizationObject &synchronizationObject,
+    const uint32_t &amount,
+    DeletionQueue &deletionQueue,
+    FrameReadback *readback,
+    AsyncCompute *compute,
+    FrameDepthController *depth) -> void {
+    SynchronizationObject &sync = synchronizationObject;
+    const uint32_t previous = sync.amount;
+
+    if (amount == previous || amount == 0) {
+        return;
+    }
 
-    vkDeviceWaitIdle(device);
+    if (amount > previous) {
+        const uint32_t added = amount - previous;
 
-    SwapChain swapChain =
-        createSwapChain(device, physicalDevice, surface, glfwWindowPtr);
+        for (auto &semaphore : createSemaphores(
+                 device, added, "render finished semaphore", previous)) {
+            sync.renderFinishedSemaphores.push_back(std::move(semaphore));
+        }
 
-    auto swapChainImages = vulkanctx::retriveSwapChainImages(
-        device, swapChain.handle, swapChain.count);
+        for (auto &fence : createInFlightFences(device, added, previous)) {
+            sync.inFlightFences.push_back(std::move(fence));
+        }
 
-    auto swapChainImageViews =
-        vulkanctx::createImageViews(device, swapChainImages, swapChain.format);
+        for (auto &target : targets) {
+            for (auto &semaphore : createSemaphores(
+                     device, added, "image available semaphore", previous)) {
+                target.imageAvailableSemaphores.push_back(
+                    std::move(semaphore));
+            }
+        }
 
-    auto renderPass = vulkanctx::createRenderPass(device, swapChain.format);
+        sync.fenceFrames.resize(amount, 0);
+        sync.amount = amount;
+        return;
+    }
 
-    auto graphicsPipeline =
-        vulkanctx::createGraphicsPipeline(device, renderPass, swapChain.extent);
+    std::vector<VkFence> fences;
 
-    auto framebuffers = vulkanctx::createFramebuffers(
-        device, renderPass, swapChainImageViews, swapChain.extent);
-}
+    for (const auto &fence : sync.inFlightFences) {
+        fences.push_back(fence.get());
+    }
 
-auto vulkanctx::cleanup(const VkInstance &instance,
-                        const VkDevice &device,
-                        const VkSurfaceKHR &surface,
-                        const VkSwapchainKHR &swapChain,
-                        const std::vector<VkImageView> &swapChainImageViews,
-                        const VkRenderPass &renderPass,
-                        const VkPipelineLayout &pipelineLayout,
-                        const VkPipeline &pipeline,
-                        const std::vector<VkFramebuffer> &swapChainFramebuffers,
-                        const VkCommandPool &commandPool,
-                        const SynchronizationObject &synchronizationObject,
-                        const VkDebugUtilsMessengerEXT &debugMessenger)
-    -> void {
+    vkWaitForFences(device,
+                    static_cast<uint32_t>(fences.size()),
+                    fences.data(),
+                    VK_TRUE,
+                    UINT64_MAX);
+
+    sync.retiredFrame = std::max(
+        sync.retiredFrame,
+        *std::max_element(sync.fenceFrames.begin(), sync.fenceFrames.end()));
 
-    for (size_t i = 0; i < synchronizationObject.amount; i++) {
-        vkDestroySemaphore(
-            device, synchronizationObject.renderFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(
-            device, synchronizationObject.imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(
-            device, synchronizationObject.inFlightFences[i], nullptr);
+    // The fences say nothing about the presents, which wait on the render
+    // finished semaphores. Past this the semaphores are unused, as are the
+    // image available ones whose submissions the fences covered.
+    if (vkQueueWaitIdle(presentQueue) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to wait for the present queue");
     }
 
-    vkDestroyCommandPool(device, commandPool, nullptr);
+    for (uint32_t slot = 0; slot < previous; slot++) {
+        if (readback != nullptr) {
+            readback->collect(slot);
+        }
 
-    for (auto framebuffer : swapChainFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
-    }
+        if (compute != nullptr) {
+            compute->collect(slot);
+        }
 
-    vkDestroyPipeline(device, pipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    vkDestroyRenderPass(device, renderPass, nullptr);
-    for (auto imageView : swapChainImageViews) {
-        vkDestroyImageView(device, imageView, nullptr);
+        if (depth != nullptr) {
+            depth->collect(slot);
+        }
     }
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
-    vkDestroyDevice(device, nullptr);
+    // Nothing uses the handles anymore, but the deletion queue keeps the
+    // order of destruction with everything else retired up to this frame
+    auto retireTail = [&](auto &handles) {
+        using Handles = std::remove_reference_t<decltype(handles)>;
+
+        Handles removed;
+        std::move(handles.begin() + amount,
+                  handles.end(),
+                  std::back_inserter(removed));
+        handles.erase(handles.begin() + amount, handles.end());
+
+        deletionQueue.retire(sync.submittedFrame, std::move(removed));
+    };
+
+    retireTail(sync.renderFinishedSemaphores);
+    retireTail(sync.inFlightFences);
 
-    if (enableValidationLayers && debugMessenger != nullptr) {
-        destroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+    for (auto &target : targets) {
+        retireTail(target.imageAvailableSemaphores);
+
+        // Would name fences about to be destroyed, and every frame is done
+        std::fill(target.imagesInFlight.begin(),
+                  target.imagesInFlight.end(),
+                  VK_NULL_HANDLE);
     }
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
-    vkDestroyInstance(instance, nullptr);
+    sync.fenceFrames.resize(amount);
+    sync.amount = amount;
+}
+
+auto vulkanctx::recreateSwapChain(const VkDevice &device,
+                                  const VkPhysicalDevice &physicalDevice,
+                                  const VkExtent2D &framebufferSize,
+                                  PresentTarget &target,
+                                  SynchronizationObject &synchronizationObject,
+                                  DeletionQueue &deletionQueue) -> void {
+    SwapChainResources &resources = target.resources;
+
+    // Built on the side so that a failure leaves the current resources intact
+    SwapChainResources next;
+
+    next.swapChain = createSwapChain(device,
+                                     physicalDevice,
+                                     target.surface,
+                                     framebufferSize,
+                                     resources.swapChain.handle);
+    next.images = retriveSwapChainImages(
+        device, next.swapChain.handle, next.swapChain.count);
+    next.imageViews =
+        createImageViews(device, next.images, next.swapChain.format);
+    next.renderPass = createRenderPass(device, next.swapChain.format);
+    next.graphicsPipeline = createGraphicsPipeline(
+        device, next.renderPass, next.swapChain.extent);
+    next.framebuffers = createFramebuffers(
+        device, next.renderPass, next.imageViews, next.swapChain.extent);
+    next.commandBuffers =
+        createCommandBuffers(device,
+                             next.swapChain.extent,
+                             next.renderPass,
+                             next.graphicsPipeline.handle,
+                             target.commandPool,
+                             next.framebuffers);
+
+    // Frames that are still in flight may reference any of these
+    const uint64_t lastUsedFrame = synchronizationObject.submittedFrame;
+
+    deletionQueue.retire(lastUsedFrame, std::move(resources.commandBuffers));
+    deletionQueue.retire(lastUsedFrame, std::move(resources.framebuffers));
+    deletionQueue.retire(lastUsedFrame,
+                         std::move(resources.graphicsPipeline.handle));
+    deletionQueue.retire(lastUsedFrame,
+                         std::move(resources.graphicsPipeline.layout));
+    deletionQueue.retire(lastUsedFrame, std::move(resources.renderPass));
+    deletionQueue.retire(lastUsedFrame, std::move(resources.imageViews));
+    deletionQueue.retire(lastUsedFrame, std::move(resources.swapChain.handle));
+
+    resources = std::move(next);
+
+    // The fences of the old images say nothing about the new ones
+    target.imagesInFlight.assign(resources.images.size(), VK_NULL_HANDLE);
+    target.stale = false;
+
+    // A pending present belongs to the retired swap chain
+    target.presentPending = false;
 }
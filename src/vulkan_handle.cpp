@@ -0,0 +1,129 @@
+#include "vulkan_handle.h"
+#include "device_dispatch.h"
+#include "host_allocator.h"
+#include "validation_sink.h"
+#include "vulkan_context.h"
+
+#define UNUSED(x) (void)(x)
+
+auto vulkanctx::InstanceTraits::destroy(const Parent &parent,
+                                        const Handle &handle) -> void {
+    UNUSED(parent);
+    vkDestroyInstance(handle, hostAllocator());
+
+    // Started by createInstance; nothing can report anymore past this point
+    validationSink().stop();
+}
+
+auto vulkanctx::DebugMessengerTraits::destroy(const Parent &parent,
+                                              const Handle &handle) -> void {
+    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
+        parent, "vkDestroyDebugUtilsMessengerEXT");
+
+    if (func != nullptr) {
+        func(parent, handle, hostAllocator());
+    }
+}
+
+auto vulkanctx::SurfaceTraits::destroy(const Parent &parent,
+                                       const Handle &handle) -> void {
+    vkDestroySurfaceKHR(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::DeviceTraits::destroy(const Parent &parent,
+                                      const Handle &handle) -> void {
+    UNUSED(parent);
+    vkDestroyDevice(handle, hostAllocator());
+    unloadDeviceDispatch();
+}
+
+auto vulkanctx::SwapchainTraits::destroy(const Parent &parent,
+                                         const Handle &handle) -> void {
+    vkDestroySwapchainKHR(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::ImageTraits::destroy(const Parent &parent,
+                                     const Handle &handle) -> void {
+    vkDestroyImage(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::ImageViewTraits::destroy(const Parent &parent,
+                                         const Handle &handle) -> void {
+    vkDestroyImageView(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::ShaderModuleTraits::destroy(const Parent &parent,
+                                            const Handle &handle) -> void {
+    vkDestroyShaderModule(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::RenderPassTraits::destroy(const Parent &parent,
+                                          const Handle &handle) -> void {
+    vkDestroyRenderPass(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::PipelineLayoutTraits::destroy(const Parent &parent,
+                                              const Handle &handle) -> void {
+    vkDestroyPipelineLayout(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::PipelineTraits::destroy(const Parent &parent,
+                                        const Handle &handle) -> void {
+    vkDestroyPipeline(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::DescriptorSetLayoutTraits::destroy(const Parent &parent,
+                                                   const Handle &handle)
+    -> void {
+    vkDestroyDescriptorSetLayout(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::DescriptorPoolTraits::destroy(const Parent &parent,
+                                              const Handle &handle) -> void {
+    vkDestroyDescriptorPool(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::SamplerTraits::destroy(const Parent &parent,
+                                       const Handle &handle) -> void {
+    vkDestroySampler(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::FramebufferTraits::destroy(const Parent &parent,
+                                           const Handle &handle) -> void {
+    vkDestroyFramebuffer(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::CommandPoolTraits::destroy(const Parent &parent,
+                                           const Handle &handle) -> void {
+    vkDestroyCommandPool(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::CommandBufferTraits::destroy(const Parent &parent,
+                                             const Handle &handle) -> void {
+    vkFreeCommandBuffers(parent.device, parent.commandPool, 1, &handle);
+}
+
+auto vulkanctx::BufferTraits::destroy(const Parent &parent,
+                                      const Handle &handle) -> void {
+    vkDestroyBuffer(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::DeviceMemoryTraits::destroy(const Parent &parent,
+                                            const Handle &handle) -> void {
+    vkFreeMemory(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::QueryPoolTraits::destroy(const Parent &parent,
+                                         const Handle &handle) -> void {
+    vkDestroyQueryPool(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::SemaphoreTraits::destroy(const Parent &parent,
+                                         const Handle &handle) -> void {
+    vkDestroySemaphore(parent, handle, hostAllocator());
+}
+
+auto vulkanctx::FenceTraits::destroy(const Parent &parent,
+                                     const Handle &handle) -> void {
+    vkDestroyFence(parent, handle, hostAllocator());
+}